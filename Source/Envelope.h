@@ -10,69 +10,75 @@
 
 #pragma once
 
+#include "Lanes.h"
+
 const float SILENCE = 0.0001f; // mute threshold
 
-class Envelope
+// A bank of analog-style envelopes, one per lane
+class EnvelopeBank
 {
 public:
 
-    float nextValue()
+    // Advance every active lane by one step
+    void nextValue(const LaneMask* active, float* output)
     {
-        level = multiplier * (level - target) + target;
+        for (int i = 0; i < LANES; ++i) {
+            float l = multiplier[i] * (level[i] - target[i]) + target[i];
 
-        // Switch from attack to decay  & sustain values
-        if (level + target > 3.0f) {
-            multiplier = decayMultiplier;
-            target = sustainLevel;
-        }
+            // Switch from attack to decay  & sustain values
+            LaneMask decay = active[i] & laneMask(l + target[i] > 3.0f);
 
-        return level;
+            level[i] = laneSelect(active[i], l, level[i]);
+            multiplier[i] = laneSelect(decay, decayMultiplier[i], multiplier[i]);
+            target[i] = laneSelect(decay, sustainLevel[i], target[i]);
+            output[i] = l;
+        }
     }
-    
+
     // Return target if it's still in attack phase
-    inline bool isInAttack() const
+    inline bool isInAttack(int lane) const
     {
-        return target >= 2.0f;
+        return target[lane] >= 2.0f;
     }
 
-    void attack()
+    void attack(int lane)
     {
         // Start envelope above threshold so it's not muted
-        level += SILENCE + SILENCE;
+        level[lane] += SILENCE + SILENCE;
         // Target to end attack phase
-        target = 2.0f;
+        target[lane] = 2.0f;
         // Set time constant
-        multiplier = attackMultiplier;
+        multiplier[lane] = attackMultiplier[lane];
     }
 
-    void release()
+    void release(int lane)
     {
-        target = 0.0f;
-        multiplier = releaseMultiplier;
+        target[lane] = 0.0f;
+        multiplier[lane] = releaseMultiplier[lane];
     }
 
     // mute envelope if below SILENCE const
-    inline bool isActive() const
+    inline bool isActive(int lane) const
     {
-        return level > SILENCE;
+        return level[lane] > SILENCE;
     }
 
-    void reset()
+    void reset(int lane)
     {
-        level = 0.0f;
-        target = 0.0f;
-        multiplier = 0.0f;
+        level[lane] = 0.0f;
+        target[lane] = 0.0f;
+        multiplier[lane] = 0.0f;
     }
 
-    float level;
+    float level[LANES];
 
-    float attackMultiplier;
-    float decayMultiplier;
-    float sustainLevel;
-    float releaseMultiplier;
+    float attackMultiplier[LANES];
+    float decayMultiplier[LANES];
+    float sustainLevel[LANES];
+    float releaseMultiplier[LANES];
 
 private:
-    float multiplier;
-    float target;
+    float multiplier[LANES];
+    float target[LANES];
 
-};
\ No newline at end of file
+};
@@ -0,0 +1,166 @@
+/*
+  ==============================================================================
+
+    EventCoalescer.cpp
+    Created: 20 Oct 2026 2:37:10pm
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#include "EventCoalescer.h"
+#include <algorithm>
+
+int EventCoalescer::keyOf(const MidiEvent& event)
+{
+    int base = (event.data0 & 0x0F) * KEYS_PER_CHANNEL;
+    switch (event.data0 & 0xF0) {
+        case 0xB0:
+            // Pedals and switches act on the notes, data increment and the
+            // (N)RPN numbers depend on what came before, and 120 and up are
+            // channel mode messages
+            if ((event.data1 >= 0x40 && event.data1 <= 0x45)
+                || (event.data1 >= 0x60 && event.data1 <= 0x65)
+                || event.data1 >= 0x78) {
+                return -1;
+            }
+            return base + event.data1;
+        // Poly pressure
+        case 0xA0:
+            return base + 128 + (event.data1 & 0x7F);
+        // Pitch bend
+        case 0xE0:
+            return base + 256;
+        // Channel pressure
+        case 0xD0:
+            return base + 257;
+    }
+    return -1;
+}
+
+int EventCoalescer::process(MidiEvent* events, int numEvents, int gridSize)
+{
+    if (gridSize > 1) {
+        int lastPosition = 0;
+        for (int i = 0; i < numEvents; ++i) {
+            MidiEvent& event = events[i];
+            if (keyOf(event) >= 0) {
+                event.position = std::max(event.position - event.position % gridSize, lastPosition);
+            }
+            lastPosition = event.position;
+        }
+    }
+
+    // From the back, so the message that stays is the last one. A run ends
+    // at a new sample or at a message that isn't a controller.
+    int laterPosition = -1;
+    bool laterIsController = false;
+    for (int i = numEvents - 1; i >= 0; --i) {
+        MidiEvent& event = events[i];
+        int key = keyOf(event);
+        if (!laterIsController || event.position != laterPosition) {
+            ++run;
+        }
+        laterPosition = event.position;
+        laterIsController = key >= 0;
+
+        if (key >= 0) {
+            if (seen[key] == run) {
+                event.data0 = 0; // dropped below
+            }
+            else {
+                seen[key] = run;
+            }
+        }
+    }
+
+    int count = 0;
+    for (int i = 0; i < numEvents; ++i) {
+        if (events[i].data0 != 0) {
+            events[count++] = events[i];
+        }
+    }
+    return count;
+}
+
+void EventCoalescer::add(Queue& queue, MidiEvent event, int gridSize)
+{
+    int key = keyOf(event);
+    if (key >= 0 && gridSize > 1) {
+        event.position = std::max(event.position - event.position % gridSize, queue.lastPosition);
+    }
+
+    // The run goes on while controller messages come in on the same sample
+    bool sameRun = key >= 0 && queue.run != 0 && event.position == queue.lastPosition;
+    if (sameRun && seen[key] == queue.run) {
+        // The new value goes behind the messages that came in since, two
+        // controllers can set the same thing. The old one is dropped and
+        // the rest of the run, all controllers on this sample, moves up.
+        for (int i = pending[key] + 1; i < queue.numEvents; ++i) {
+            queue.events[i - 1] = queue.events[i];
+            pending[keyOf(queue.events[i - 1])] = i - 1;
+        }
+        queue.events[queue.numEvents - 1] = event;
+        pending[key] = queue.numEvents - 1;
+        return;
+    }
+
+    if (queue.numEvents == queue.capacity) {
+        if (!makeRoom(queue)) { return; }
+        sameRun = false; // the messages have moved
+    }
+
+    queue.lastPosition = event.position;
+    if (key >= 0) {
+        if (!sameRun) {
+            queue.run = ++run;
+        }
+        seen[key] = queue.run;
+        pending[key] = queue.numEvents;
+    }
+    else {
+        queue.run = 0;
+    }
+    queue.events[queue.numEvents++] = event;
+}
+
+bool EventCoalescer::makeRoom(Queue& queue)
+{
+    // From the back, a controller message that comes up again later
+    // only sets a value for a while
+    ++run;
+    int numDropped = 0;
+    for (int i = queue.numEvents - 1; i >= 0; --i) {
+        MidiEvent& event = queue.events[i];
+        int key = keyOf(event);
+        if (key < 0) { continue; }
+        if (seen[key] == run) {
+            event.data0 = 0;
+            ++numDropped;
+        }
+        else {
+            seen[key] = run;
+        }
+    }
+
+    // Otherwise the oldest controller message goes
+    if (numDropped == 0) {
+        for (int i = 0; i < queue.numEvents; ++i) {
+            if (keyOf(queue.events[i]) >= 0) {
+                queue.events[i].data0 = 0;
+                numDropped = 1;
+                break;
+            }
+        }
+        if (numDropped == 0) { return false; }
+    }
+
+    int count = 0;
+    for (int i = 0; i < queue.numEvents; ++i) {
+        if (queue.events[i].data0 != 0) {
+            queue.events[count++] = queue.events[i];
+        }
+    }
+    queue.numEvents = count;
+    return true;
+}
@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    EventCoalescer.h
+    Created: 20 Oct 2026 2:37:10pm
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+
+// One MIDI message of a block, at its sample position
+struct MidiEvent
+{
+    int position;
+    uint8_t data0, data1, data2;
+};
+
+// Thins out the MIDI of a block before it's rendered. The synth renders a
+// new segment at every event, so a controller sweep with hundreds of
+// messages per block would otherwise render a few samples at a time.
+class EventCoalescer
+{
+public:
+    // Optionally snaps the controller messages onto a grid of gridSize
+    // samples from the start of the block (1 = no grid), never moving one
+    // before the event ahead of it. Then drops the controller messages that
+    // a later one for the same controller on the same sample overrides,
+    // unless something else comes in between. Notes and the other messages
+    // keep their place. Works in place and returns the new count.
+    int process(MidiEvent* events, int numEvents, int gridSize);
+
+    // A buffer of fixed size that add() fills. Several can share one
+    // coalescer as long as each gets its own MIDI channels.
+    struct Queue
+    {
+        MidiEvent* events = nullptr;
+        int capacity = 0;
+        int numEvents = 0;
+        int lastPosition = 0;
+        uint32_t run = 0; // 0 when the last message wasn't a controller
+
+        void clear() { numEvents = 0; lastPosition = 0; run = 0; }
+    };
+
+    // The same while the messages are collected, so nothing has to be
+    // dropped before it's coalesced. Gives what process() gives, as long
+    // as the queue has room. When it's full the older controller messages
+    // make room, the ones a later message overrides first. A note or other
+    // message is only lost when the queue holds nothing but those.
+    void add(Queue& queue, MidiEvent event, int gridSize);
+
+private:
+    // Controller messages that only set a value: control change, pitch
+    // bend and pressure. Returns where that value is in seen[], or -1 for
+    // any other message.
+    static int keyOf(const MidiEvent& event);
+
+    // Control changes, poly pressure, pitch bend and channel pressure
+    static constexpr int KEYS_PER_CHANNEL = 128 + 128 + 2;
+
+    // Keys set later in the current run of controller messages on one
+    // sample; an entry belongs to the run if it holds the run's number
+    uint32_t seen[16 * KEYS_PER_CHANNEL] = {};
+    uint32_t run = 0;
+
+    // For add(), where the key's message of the run is in the queue
+    int pending[16 * KEYS_PER_CHANNEL] = {};
+
+    // Drops controller messages from a full queue, false if it has none
+    bool makeRoom(Queue& queue);
+};
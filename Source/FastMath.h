@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    FastMath.h
+    Created: 17 Oct 2026 4:18:52pm
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Polynomial approximations for the control-rate math. The max errors below
+// are relative to the double precision result and are checked by JX11Bench.
+namespace FastMath
+{
+    const float LOG2_E = 1.4426950408889634f;
+    const float HALF_PI = 1.5707963267948966f;
+    const float QUARTER_PI = 0.7853981633974483f;
+
+    // 2^x for -126 <= x <= 127, max relative error 2e-7
+    inline float exp2(float x)
+    {
+        // Split into integer part and a fraction in [-0.5, 0.5]
+        float whole = float(int(x + 128.5f)) - 128.0f;
+        float f = x - whole;
+
+        // Minimax polynomial for 2^f (Cephes)
+        float p = 1.535336188319500e-4f;
+        p = p * f + 1.339887440266574e-3f;
+        p = p * f + 9.618437357674640e-3f;
+        p = p * f + 5.550332471162809e-2f;
+        p = p * f + 2.402264791363012e-1f;
+        p = p * f + 6.931472028550421e-1f;
+        p = p * f + 1.0f;
+
+        // Scale by 2^whole by writing the exponent bits
+        uint32_t bits = uint32_t(int(whole) + 127) << 23;
+        float scale;
+        std::memcpy(&scale, &bits, sizeof(scale));
+        return p * scale;
+    }
+
+    // e^x for -87 <= x < 88, max relative error 1e-6 for |x| < 10 and 5e-6
+    // over the whole range
+    inline float exp(float x)
+    {
+        return exp2(x * LOG2_E);
+    }
+
+    // tan(x) for 0 <= x < PI/2, max relative error 5e-7 for the filter's
+    // 30 - 20000 Hz cutoff range at 44.1 kHz and above, 1e-6 up to x = 1.5
+    inline float tan(float x)
+    {
+        // Above PI/4 use tan(x) = 1 / tan(PI/2 - x)
+        bool reflect = x > QUARTER_PI;
+        float y = reflect ? HALF_PI - x : x;
+
+        // Minimax polynomial for tan on [0, PI/4] (Cephes)
+        float z = y * y;
+        float p = 9.38540185543e-3f;
+        p = p * z + 3.11992232697e-3f;
+        p = p * z + 2.44301354525e-2f;
+        p = p * z + 5.34112807005e-2f;
+        p = p * z + 1.33387994085e-1f;
+        p = p * z + 3.33331568548e-1f;
+        float t = p * z * y + y;
+
+        return reflect ? 1.0f / t : t;
+    }
+}
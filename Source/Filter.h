@@ -10,45 +10,116 @@
 
 #pragma once
 
-class Filter
+#include "Lanes.h"
+#include "FastMath.h"
+
+// A bank of state variable low-pass filters, one per lane
+class FilterBank
 {
 public:
     float sampleRate;
 
-    void updateCoefficients(float cutoff, float Q)
+    // Update the coeffs of every active lane, inactive lanes keep theirs.
+    // With a rampLength the coeffs glide there over that many samples
+    // instead of jumping, 0 sets them right away. Lanes in stacks of stack
+    // lanes, like a unison note, take the coeffs of the stack's first lane
+    // when they have the same cutoff.
+    void updateCoefficients(const LaneMask* active, const float* cutoff, float Q, int rampLength = 0,
+                            int stack = 1)
+    {
+        float k = 1.0f / Q;
+        float b1[LANES], b2[LANES], b3[LANES];
+        if (stack <= 1) {
+            for (int i = 0; i < LANES; ++i) {
+                calcCoefficients(cutoff[i], k, b1[i], b2[i], b3[i]);
+            }
+        }
+        else {
+            for (int i = 0; i < LANES; ++i) {
+                int first = i - i % stack;
+                if (first != i && cutoff[i] == cutoff[first]) {
+                    b1[i] = b1[first];
+                    b2[i] = b2[first];
+                    b3[i] = b3[first];
+                }
+                else {
+                    calcCoefficients(cutoff[i], k, b1[i], b2[i], b3[i]);
+                }
+            }
+        }
+        setCoefficients(active, b1, b2, b3, rampLength);
+    }
+
+    // Stops the glides, the coeffs stay where they are
+    void holdCoefficients()
     {
-        g = std::tan(PI * cutoff / sampleRate);
-        k = 1.0f / Q;
-        a1 = 1.0f / (1.0f + g * (g + k));
-        a2 = g * a1;
-        a3 = g * a2;
+        for (int i = 0; i < LANES; ++i) {
+            d1[i] = 0.0f;
+            d2[i] = 0.0f;
+            d3[i] = 0.0f;
+        }
     }
 
-    void reset()
+    void reset(int lane)
     {
-        g = 0.0f;
-        k = 0.0f;
-        a1 = 0.0f;
-        a2 = 0.0f;
-        a3 = 0.0f;
-
-        ic1eq = 0.0f;
-        ic2eq = 0.0f;
+        a1[lane] = 0.0f;
+        a2[lane] = 0.0f;
+        a3[lane] = 0.0f;
+        d1[lane] = 0.0f;
+        d2[lane] = 0.0f;
+        d3[lane] = 0.0f;
+
+        ic1eq[lane] = 0.0f;
+        ic2eq[lane] = 0.0f;
     }
 
-    float render(float x)
+    // Filter one sample on every active lane
+    void render(const LaneMask* active, const float* input, float* output)
     {
-        float v3 = x - ic2eq; // hpf
-        float v1 = a1 * ic1eq + a2 * v3; // bpf
-        float v2 = ic2eq + a2 * ic1eq + a3 * v3; // lpf
-        ic1eq = 2.0f * v1 - ic1eq;
-        ic2eq = 2.0f * v2 - ic2eq;
-        return v2;
+        for (int i = 0; i < LANES; ++i) {
+            float v3 = input[i] - ic2eq[i]; // hpf
+            float v1 = a1[i] * ic1eq[i] + a2[i] * v3; // bpf
+            float v2 = ic2eq[i] + a2[i] * ic1eq[i] + a3[i] * v3; // lpf
+            ic1eq[i] = laneSelect(active[i], 2.0f * v1 - ic1eq[i], ic1eq[i]);
+            ic2eq[i] = laneSelect(active[i], 2.0f * v2 - ic2eq[i], ic2eq[i]);
+            output[i] = v2;
+
+            // Without a glide the steps are 0 and the coeffs stay put
+            a1[i] = laneSelect(active[i], a1[i] + d1[i], a1[i]);
+            a2[i] = laneSelect(active[i], a2[i] + d2[i], a2[i]);
+            a3[i] = laneSelect(active[i], a3[i] + d3[i], a3[i]);
+        }
     }
 
 private:
     const float PI = 3.1415926535897932f;
 
-    float g, k, a1, a2, a3; // Filter coeffs
-    float ic1eq, ic2eq; // filter states
-};
\ No newline at end of file
+    void calcCoefficients(float cutoff, float k, float& b1, float& b2, float& b3) const
+    {
+        float g = FastMath::tan(PI * cutoff / sampleRate);
+        b1 = 1.0f / (1.0f + g * (g + k));
+        b2 = g * b1;
+        b3 = g * b2;
+    }
+
+    void setCoefficients(const LaneMask* active, const float* b1, const float* b2, const float* b3,
+                         int rampLength)
+    {
+        float inverseRamp = (rampLength > 0) ? 1.0f / float(rampLength) : 0.0f;
+        for (int i = 0; i < LANES; ++i) {
+            // A lane that was just reset has no coeffs to glide from
+            LaneMask ramp = active[i] & laneMask(rampLength > 0 && a1[i] != 0.0f);
+            d1[i] = laneSelect(ramp, (b1[i] - a1[i]) * inverseRamp, 0.0f);
+            d2[i] = laneSelect(ramp, (b2[i] - a2[i]) * inverseRamp, 0.0f);
+            d3[i] = laneSelect(ramp, (b3[i] - a3[i]) * inverseRamp, 0.0f);
+            LaneMask jump = active[i] & ~ramp;
+            a1[i] = laneSelect(jump, b1[i], a1[i]);
+            a2[i] = laneSelect(jump, b2[i], a2[i]);
+            a3[i] = laneSelect(jump, b3[i], a3[i]);
+        }
+    }
+
+    float a1[LANES], a2[LANES], a3[LANES]; // Filter coeffs
+    float d1[LANES], d2[LANES], d3[LANES]; // per sample steps of the coeffs
+    float ic1eq[LANES], ic2eq[LANES]; // filter states
+};
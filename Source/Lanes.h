@@ -0,0 +1,41 @@
+/*
+  ==============================================================================
+
+    Lanes.h
+    Created: 17 Oct 2026 10:12:31am
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Number of voices processed side by side. All per-voice DSP state is stored
+// as arrays of this size (structure of arrays), so the loops over the lanes
+// have a fixed trip count and map onto AVX (8 floats) or 2x SSE registers.
+const int LANES = 8;
+
+// All bits set for lanes that take part in an operation, zero otherwise
+using LaneMask = uint32_t;
+
+inline LaneMask laneMask(bool condition)
+{
+    return LaneMask(0) - LaneMask(condition);
+}
+
+// Branch-free select: a where the mask is set, b otherwise. Blending the bit
+// patterns keeps the lane loops free of control flow, so the compiler can
+// vectorize them instead of emitting a branch per lane.
+inline float laneSelect(LaneMask mask, float a, float b)
+{
+    uint32_t ua, ub;
+    std::memcpy(&ua, &a, sizeof(float));
+    std::memcpy(&ub, &b, sizeof(float));
+    uint32_t bits = (ua & mask) | (ub & ~mask);
+    float result;
+    std::memcpy(&result, &bits, sizeof(float));
+    return result;
+}
@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    LoadMeter.cpp
+    Created: 19 Oct 2026 10:21:37am
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#include "LoadMeter.h"
+#include <algorithm>
+
+LoadMeter::LoadMeter(int historySize_)
+    : historySize(std::max(historySize_, 1))
+{
+}
+
+double LoadMeter::bucketStart(int bucket)
+{
+    if (bucket <= 10) { return 0.1 * bucket; }
+    return 2.0;
+}
+
+void LoadMeter::prepare(double newSampleRate)
+{
+    sampleRate.store(newSampleRate);
+    history.reserve(size_t(historySize));
+    sorted.reserve(size_t(historySize));
+}
+
+LoadMeter::Scope::Scope(LoadMeter& meter_, int numSamples_)
+    : meter(meter_), numSamples(numSamples_), start(std::chrono::steady_clock::now())
+{
+}
+
+LoadMeter::Scope::~Scope()
+{
+    meter.push(std::chrono::steady_clock::now() - start, numSamples);
+}
+
+void LoadMeter::push(std::chrono::steady_clock::duration elapsed, int numSamples)
+{
+    uint32_t write = writeIndex.load(std::memory_order_relaxed);
+    if (write - readIndex.load(std::memory_order_acquire) >= uint32_t(RING_SIZE)) {
+        missed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    Block& block = ring[write % RING_SIZE];
+    block.nanoseconds = uint32_t(std::clamp<long long>(ns, 0, UINT32_MAX));
+    block.numSamples = uint32_t(std::max(numSamples, 0));
+    writeIndex.store(write + 1, std::memory_order_release);
+}
+
+LoadMeter::Summary LoadMeter::update()
+{
+    // Take what the audio thread wrote, the oldest blocks fall out of the
+    // history
+    uint32_t read = readIndex.load(std::memory_order_relaxed);
+    uint32_t write = writeIndex.load(std::memory_order_acquire);
+    for (; read != write; ++read) {
+        const Block& block = ring[read % RING_SIZE];
+        if (int(history.size()) < historySize) {
+            history.push_back(block);
+        }
+        else {
+            history[size_t(historyStart)] = block;
+            historyStart = (historyStart + 1) % historySize;
+        }
+    }
+    readIndex.store(read, std::memory_order_release);
+
+    Summary summary;
+    summary.missed = missed.load(std::memory_order_relaxed);
+    summary.blocks = int(history.size());
+    if (history.empty()) { return summary; }
+
+    const double rate = sampleRate.load();
+    double renderSeconds = 0.0;
+    double audioSeconds = 0.0;
+    sorted.clear();
+    for (const Block& block : history) {
+        double seconds = double(block.nanoseconds) * 1e-9;
+        double budget = double(block.numSamples) / rate;
+        renderSeconds += seconds;
+        audioSeconds += budget;
+        sorted.push_back(block.nanoseconds);
+
+        // An empty block has no budget, count it as overrun if it took any time
+        double load = (budget > 0.0) ? seconds / budget : ((seconds > 0.0) ? 2.0 : 0.0);
+        summary.peakLoad = std::max(summary.peakLoad, load);
+        if (load > 1.0) { summary.overruns += 1; }
+
+        int bucket = 0;
+        while (bucket < NUM_BUCKETS - 1 && load >= bucketStart(bucket + 1)) { ++bucket; }
+        summary.histogram[bucket] += 1;
+    }
+    summary.load = (audioSeconds > 0.0) ? renderSeconds / audioSeconds : 0.0;
+
+    // Percentiles by rank, the p99 of a short history is close to the max
+    auto percentile = [&](double p)
+    {
+        size_t rank = std::min(sorted.size() - 1, size_t(p * double(sorted.size())));
+        std::nth_element(sorted.begin(), sorted.begin() + std::ptrdiff_t(rank), sorted.end());
+        return double(sorted[rank]) * 1e-3;
+    };
+    summary.p50 = percentile(0.5);
+    summary.p99 = percentile(0.99);
+    summary.max = double(*std::max_element(sorted.begin(), sorted.end())) * 1e-3;
+    return summary;
+}
+
+void LoadMeter::clearHistory()
+{
+    history.clear();
+    historyStart = 0;
+}
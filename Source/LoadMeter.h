@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    LoadMeter.h
+    Created: 19 Oct 2026 10:21:37am
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Times every audio block against the real time the block lasts. The audio
+// thread only reads a monotonic clock and writes the result into a lock-free
+// ring. The summary is worked out by a single reader, like the editor's
+// timer or a test harness.
+class LoadMeter
+{
+public:
+    static constexpr int RING_SIZE = 1024; // blocks waiting for the reader
+
+    // A summary covers the last historySize blocks
+    explicit LoadMeter(int historySize = 4096);
+
+    // Histogram of the load per block: ten 10 % steps, then 100-200 % and
+    // anything above
+    static constexpr int NUM_BUCKETS = 12;
+    static double bucketStart(int bucket); // lowest load in the bucket, 1 = 100 %
+
+    // Not realtime safe, call from prepareToPlay
+    void prepare(double sampleRate);
+
+    // Audio thread: times the block for as long as it's alive
+    class Scope
+    {
+    public:
+        Scope(LoadMeter& meter, int numSamples);
+        ~Scope();
+
+    private:
+        LoadMeter& meter;
+        int numSamples;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    struct Summary
+    {
+        int blocks = 0; // in the history
+        double load = 0.0; // render time over audio time, 1 = 100 %
+        double p50 = 0.0, p99 = 0.0, max = 0.0; // render time per block, in microseconds
+        double peakLoad = 0.0; // of the worst block
+        int overruns = 0; // blocks that took longer than they last
+        int histogram[NUM_BUCKETS] = {};
+        uint32_t missed = 0; // blocks that found the ring full, nobody read it
+    };
+
+    // Reader: moves the new blocks into the history and sums it up. Only one
+    // thread may call this and clearHistory().
+    Summary update();
+    void clearHistory();
+
+private:
+    struct Block
+    {
+        uint32_t nanoseconds;
+        uint32_t numSamples;
+    };
+
+    void push(std::chrono::steady_clock::duration elapsed, int numSamples);
+
+    std::atomic<double> sampleRate { 44100.0 };
+
+    // Single producer, single consumer. The writer drops a block rather
+    // than overwrite one the reader may be looking at.
+    Block ring[RING_SIZE];
+    std::atomic<uint32_t> writeIndex { 0 };
+    std::atomic<uint32_t> readIndex { 0 };
+    std::atomic<uint32_t> missed { 0 };
+
+    // Reader only
+    const int historySize;
+    std::vector<Block> history;
+    int historyStart = 0;
+    std::vector<uint32_t> sorted;
+};
@@ -0,0 +1,197 @@
+/*
+  ==============================================================================
+
+    MultiTimbralSynth.cpp
+    Created: 18 Oct 2026 3:12:40pm
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#include "MultiTimbralSynth.h"
+
+void MultiTimbralSynth::allocateResources(double sampleRate, int samplesPerBlock)
+{
+    maxBlockSize = std::max(samplesPerBlock, 1);
+    partLeft.resize(size_t(NUM_PARTS * maxBlockSize));
+    partRight.resize(size_t(NUM_PARTS * maxBlockSize));
+
+    // The threads are shared out by part, so the parts start no helpers
+    for (Part& part : parts) {
+        part.synth.allocateResources(sampleRate, maxBlockSize, 1);
+        part.events.resize(MAX_EVENTS);
+        part.queue = { part.events.data(), MAX_EVENTS };
+    }
+
+    // Helpers are started when the settings ask for them
+    threadPool.stop();
+}
+
+void MultiTimbralSynth::startRenderThreads(int numThreads)
+{
+    int cores = juce::SystemStats::getNumCpus();
+    int threads = std::min({ numThreads, MAX_THREADS, cores });
+    threadPool.start(std::max(threads - 1, 0));
+}
+
+void MultiTimbralSynth::deallocateResources()
+{
+    threadPool.stop();
+    for (Part& part : parts) {
+        part.synth.deallocateResources();
+        part.events.clear();
+        part.events.shrink_to_fit();
+        part.queue = {};
+    }
+    partLeft.clear();
+    partLeft.shrink_to_fit();
+    partRight.clear();
+    partRight.shrink_to_fit();
+    maxBlockSize = 0;
+}
+
+void MultiTimbralSynth::reset()
+{
+    for (Part& part : parts) {
+        part.synth.reset();
+        part.queue.clear();
+    }
+}
+
+void MultiTimbralSynth::resetPart(int part)
+{
+    parts[part].synth.reset();
+}
+
+void MultiTimbralSynth::setSettings(int part, const SynthSettings* newSettings)
+{
+    parts[part].synth.setSettings(newSettings);
+}
+
+void MultiTimbralSynth::setOutputLevel(int part, float gain)
+{
+    parts[part].synth.outputLevelSmoother.setTargetValue(gain);
+}
+
+void MultiTimbralSynth::addEvent(int position, uint8_t data0, uint8_t data1, uint8_t data2)
+{
+    Part& part = parts[data0 & 0x0F];
+    coalescer.add(part.queue, { std::max(position, 0), data0, data1, data2 }, 1);
+}
+
+void MultiTimbralSynth::render(float** outputBuffers, int sampleCount, int numThreads)
+{
+    float* outputBufferLeft = outputBuffers[0];
+    float* outputBufferRight = outputBuffers[1];
+
+    for (Part& part : parts) {
+        part.nextEvent = 0;
+    }
+
+    for (int offset = 0; offset < sampleCount; offset += maxBlockSize) {
+        chunkStart = offset;
+        chunkSize = std::min(sampleCount - offset, maxBlockSize);
+        int chunkEnd = chunkStart + chunkSize;
+
+        // A part that is silent and gets no notes only moves its LFO ahead,
+        // that's cheaper to do right here than to hand out
+        numBusyParts = 0;
+        for (int p = 0; p < NUM_PARTS; ++p) {
+            const Part& part = parts[p];
+            bool hasEvents = part.nextEvent < part.queue.numEvents
+                && part.events[size_t(part.nextEvent)].position < chunkEnd;
+            if (hasEvents || !part.synth.isIdle()) {
+                busyParts[numBusyParts++] = p;
+            }
+            else {
+                renderPart(p);
+            }
+        }
+
+        activeJobs = std::clamp(numThreads, 1, threadPool.getNumHelpers() + 1);
+        activeJobs = std::min(activeJobs, std::max(numBusyParts, 1));
+        if (activeJobs > 1) {
+            threadPool.run(activeJobs, renderPartsJob, this);
+        }
+        else {
+            renderParts(0);
+        }
+
+        // Mix in part order, so the result doesn't depend on the threads
+        float* left = outputBufferLeft + offset;
+        float* right = (outputBufferRight != nullptr) ? outputBufferRight + offset : nullptr;
+        std::fill(left, left + chunkSize, 0.0f);
+        if (right != nullptr) {
+            std::fill(right, right + chunkSize, 0.0f);
+        }
+        for (int i = 0; i < numBusyParts; ++i) {
+            const float* partL = partLeft.data() + busyParts[i] * maxBlockSize;
+            const float* partR = partRight.data() + busyParts[i] * maxBlockSize;
+            if (right != nullptr) {
+                for (int sample = 0; sample < chunkSize; ++sample) {
+                    left[sample] += partL[sample];
+                    right[sample] += partR[sample];
+                }
+            }
+            else {
+                for (int sample = 0; sample < chunkSize; ++sample) {
+                    left[sample] += (partL[sample] + partR[sample]) * 0.5f;
+                }
+            }
+        }
+        protectYourEars(left, right, chunkSize, safetyCounters);
+    }
+
+    for (Part& part : parts) {
+        part.queue.clear();
+    }
+}
+
+void MultiTimbralSynth::getSafetyCounts(uint32_t& silenced, uint32_t& clamped) const
+{
+    silenced = safetyCounters.silenced.load(std::memory_order_relaxed);
+    clamped = safetyCounters.clamped.load(std::memory_order_relaxed);
+    for (const Part& part : parts) {
+        silenced += part.synth.getSafetyCounters().silenced.load(std::memory_order_relaxed);
+        clamped += part.synth.getSafetyCounters().clamped.load(std::memory_order_relaxed);
+    }
+}
+
+void MultiTimbralSynth::renderPart(int p)
+{
+    Part& part = parts[p];
+    float* left = partLeft.data() + p * maxBlockSize;
+    float* right = partRight.data() + p * maxBlockSize;
+
+    // Same as splitBufferByEvents() in the plugin, for this part's events
+    int chunkEnd = chunkStart + chunkSize;
+    int position = chunkStart;
+    while (part.nextEvent < part.queue.numEvents && part.events[size_t(part.nextEvent)].position < chunkEnd) {
+        const MidiEvent& event = part.events[size_t(part.nextEvent++)];
+        int samplesThisSegment = event.position - position;
+        if (samplesThisSegment > 0) {
+            float* buffers[2] = { left + position - chunkStart, right + position - chunkStart };
+            part.synth.render(buffers, samplesThisSegment);
+            position += samplesThisSegment;
+        }
+        part.synth.midiMessage(event.data0, event.data1, event.data2);
+    }
+
+    int samplesLastSegment = chunkEnd - position;
+    if (samplesLastSegment > 0) {
+        float* buffers[2] = { left + position - chunkStart, right + position - chunkStart };
+        part.synth.render(buffers, samplesLastSegment);
+    }
+}
+
+void MultiTimbralSynth::renderParts(int job)
+{
+    for (int i = job; i < numBusyParts; i += activeJobs) {
+        renderPart(busyParts[i]);
+    }
+}
+
+void MultiTimbralSynth::renderPartsJob(void* context, int job)
+{
+    static_cast<MultiTimbralSynth*>(context)->renderParts(job);
+}
@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    MultiTimbralSynth.h
+    Created: 18 Oct 2026 3:12:40pm
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Synth.h"
+#include "RenderThreadPool.h"
+#include "EventCoalescer.h"
+
+// One synth per MIDI channel, each with its own voices and settings. The
+// parts don't share any state, so whole parts are handed to the helper
+// threads, and each part renders its voices on one thread.
+class MultiTimbralSynth
+{
+public:
+    static constexpr int NUM_PARTS = 16;
+    static constexpr int MAX_EVENTS = 1024; // per part and block, see addEvent()
+    static constexpr int MAX_THREADS = Synth::MAX_RENDER_THREADS;
+
+    // Not realtime safe, call from prepareToPlay / releaseResources
+    void allocateResources(double sampleRate, int samplesPerBlock);
+    void deallocateResources();
+
+    // Same as Synth::startRenderThreads(), the threads share the parts
+    void startRenderThreads(int numThreads);
+
+    void reset();
+    void resetPart(int part);
+
+    // Same as Synth::setSettings(), for the part on that channel
+    void setSettings(int part, const SynthSettings* newSettings);
+
+    // Glides the part to a new output level before its settings catch up
+    void setOutputLevel(int part, float gain);
+
+    // Queues a message for the part on its channel, position is the sample
+    // it happens at in the next render() call. Controller messages are
+    // coalesced as they come in and make room when a part's queue is full.
+    void addEvent(int position, uint8_t data0, uint8_t data1, uint8_t data2);
+
+    // Renders every part and mixes them into the output, then clears the
+    // queued events
+    void render(float** outputBuffers, int sampleCount, int numThreads);
+
+    // Adds up what the output safety stage did in the parts and on the mix,
+    // safe to call from any thread
+    void getSafetyCounts(uint32_t& silenced, uint32_t& clamped) const;
+
+private:
+    struct Part
+    {
+        Synth synth;
+        std::vector<MidiEvent> events;
+        EventCoalescer::Queue queue; // fills events
+        int nextEvent = 0; // first event not handled yet
+    };
+
+    // Renders part p for the current chunk, handling its events on the way
+    void renderPart(int p);
+    void renderParts(int job);
+    static void renderPartsJob(void* context, int job);
+
+    Part parts[NUM_PARTS];
+
+    // Shared by the parts, each has its own channel
+    EventCoalescer coalescer;
+
+    // Host samples per part and channel, render() splits longer buffers
+    int maxBlockSize = 0;
+    std::vector<float> partLeft, partRight;
+
+    // Parts with something to render in the current chunk
+    int busyParts[NUM_PARTS];
+    int numBusyParts = 0;
+    int chunkStart = 0;
+    int chunkSize = 0;
+    int activeJobs = 1;
+
+    RenderThreadPool threadPool;
+
+    // The parts are safe on their own, their sum may still be too loud
+    OutputSafetyCounters safetyCounters;
+};
@@ -31,6 +31,20 @@ public:
         return noise - 3.0f;
     }
 
+    // Same as calling nextValue() count times, in log(count) steps
+    void skip(int count)
+    {
+        // Combine the multiply and add of one step with itself, doubling
+        // the number of steps it stands for each time
+        unsigned int mul = 196314165;
+        unsigned int add = 907633515;
+        for (unsigned int n = unsigned(count); n > 0; n >>= 1) {
+            if (n & 1) { noiseSeed = noiseSeed * mul + add; }
+            add = add * mul + add;
+            mul = mul * mul;
+        }
+    }
+
 private:
     unsigned int noiseSeed;
 
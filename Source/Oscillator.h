@@ -10,102 +10,143 @@
 
 #pragma once
 
+#include "Lanes.h"
 
 const float PI_OVER_4 = 0.7853981633974483f;
 const float PI = 3.1415926535897932f;
 const float TWO_PI = 6.2831853071795864f;
 
-class Oscillator
+// A bank of BLIT oscillators, one per lane
+class OscillatorBank
 {
 public:
-    float period = 0.0f;
-    float amplitude;
-    float modulation = 0.5f;
+    float period[LANES];
+    float amplitude[LANES];
+    float modulation[LANES];
 
-    void reset()
+    OscillatorBank()
     {
-        inc = 0.0f;
-        phase = 0.0f;
-        sin0 = 0.0f;
-        sin1 = 0.0f;
-        dsin = 0.0f;
-        dc = 0.0f;
+        for (int i = 0; i < LANES; ++i) {
+            period[i] = 0.0f;
+            amplitude[i] = 0.0f;
+            modulation[i] = 0.5f;
+            reset(i);
+        }
     }
 
-    float nextSample()
+    void reset(int lane)
     {
-        float output = 0.0f;
-
-        phase += inc; // 1
-        if (phase <= PI_OVER_4) { // 2
-            // 3
-            float halfPeriod = period * 0.5f * modulation;
-            phaseMax = std::floor(0.5f + halfPeriod) - 0.5f;
-            dc = 0.5f * amplitude / phaseMax; // Approx DC by avg
-            phaseMax *= PI;
-
-            inc = phaseMax / halfPeriod;
-            phase = -phase;
-
-            // 4
-            sin0 = amplitude * std::sin(phase);
-            sin1 = amplitude * std::sin(phase - inc);
-            dsin = 2.0f * std::cos(inc);
-
-            if (phase * phase > 1e-9) {
-                output = sin0 / phase;
-            }
-            else {
-                output = amplitude;
-            }
-        }
-        else { // 5
+        inc[lane] = 0.0f;
+        phase[lane] = 0.0f;
+        phaseMax[lane] = 0.0f;
+        sin0[lane] = 0.0f;
+        sin1[lane] = 0.0f;
+        dsin[lane] = 0.0f;
+        dc[lane] = 0.0f;
+    }
+
+    // Advance every active lane by one sample. Inactive lanes keep their
+    // state and output silence.
+    void nextSample(const LaneMask* active, float* output)
+    {
+        float result[LANES];
+        float newPhase[LANES];
+        LaneMask restart[LANES];
+        LaneMask anyRestart = 0;
+
+        // Common case, done for all lanes at once without branches
+        for (int i = 0; i < LANES; ++i) {
+            float p = phase[i] + inc[i]; // 1
+            newPhase[i] = p;
+
             // 6
-            if (phase > phaseMax) {
-                phase = phaseMax + phaseMax - phase;
-                inc = -inc;
-            }
+            LaneMask reflect = laneMask(p > phaseMax[i]);
+            float q = laneSelect(reflect, phaseMax[i] + phaseMax[i] - p, p);
+            float dir = laneSelect(reflect, -inc[i], inc[i]);
+
             // 7
-            float sinp = dsin * sin0 - sin1;
-            sin1 = sin0;
-            sin0 = sinp;
-            output = sinp / phase;
+            float sinp = dsin[i] * sin0[i] - sin1[i];
+            float out = sinp / q - dc[i];
+
+            phase[i] = laneSelect(active[i], q, phase[i]);
+            inc[i] = laneSelect(active[i], dir, inc[i]);
+            sin1[i] = laneSelect(active[i], sin0[i], sin1[i]);
+            sin0[i] = laneSelect(active[i], sinp, sin0[i]);
+            result[i] = laneSelect(active[i], out, 0.0f);
+
+            restart[i] = active[i] & laneMask(p <= PI_OVER_4); // 2
+            anyRestart |= restart[i];
+        }
+
+        // Lanes that reached a new half period overwrite the result above
+        if (anyRestart != 0) {
+            for (int i = 0; i < LANES; ++i) {
+                if (restart[i] != 0) {
+                    result[i] = startPeriod(i, newPhase[i]);
+                }
+            }
         }
 
-        return output - dc;
+        std::memcpy(output, result, sizeof(result));
     }
 
-    void squareWave(Oscillator& other, float newPeriod)
+    void squareWave(int lane, const OscillatorBank& other, float newPeriod)
     {
-        reset(); // Reset oscillator
+        reset(lane); // Reset oscillator
         // Figure out phase and sign of other osc
-        if (other.inc > 0.0f) {
-            phase = other.phaseMax + other.phaseMax - other.phase;
-            inc = -other.inc;
+        if (other.inc[lane] > 0.0f) {
+            phase[lane] = other.phaseMax[lane] + other.phaseMax[lane] - other.phase[lane];
+            inc[lane] = -other.inc[lane];
         }
-        else if (other.inc < 0.0f) {
-            phase = other.phase;
-            inc = other.inc;
+        else if (other.inc[lane] < 0.0f) {
+            phase[lane] = other.phase[lane];
+            inc[lane] = other.inc[lane];
         } // If osc hasn't started
         else {
-            phase = -PI;
-            inc = PI;
+            phase[lane] = -PI;
+            inc[lane] = PI;
         }
         // Shift phase by half a period
-        phase += PI * newPeriod * 0.5f;
-        phaseMax = phase;
+        phase[lane] += PI * newPeriod * 0.5f;
+        phaseMax[lane] = phase[lane];
     }
 
 private:
-    float phase;
-    float phaseMax;
-    float inc;
+    float startPeriod(int i, float p)
+    {
+        // 3
+        float halfPeriod = period[i] * 0.5f * modulation[i];
+        phaseMax[i] = std::floor(0.5f + halfPeriod) - 0.5f;
+        dc[i] = 0.5f * amplitude[i] / phaseMax[i]; // Approx DC by avg
+        phaseMax[i] *= PI;
+
+        inc[i] = phaseMax[i] / halfPeriod;
+        phase[i] = -p;
+
+        // 4
+        sin0[i] = amplitude[i] * std::sin(phase[i]);
+        sin1[i] = amplitude[i] * std::sin(phase[i] - inc[i]);
+        dsin[i] = 2.0f * std::cos(inc[i]);
+
+        float output;
+        if (phase[i] * phase[i] > 1e-9) {
+            output = sin0[i] / phase[i];
+        }
+        else {
+            output = amplitude[i];
+        }
+        return output - dc[i];
+    }
+
+    float phase[LANES];
+    float phaseMax[LANES];
+    float inc[LANES];
 
     // for efficient sine
-    float sin0;
-    float sin1;
-    float dsin;
+    float sin0[LANES];
+    float sin1[LANES];
+    float dsin[LANES];
 
     // for DC removal
-    float dc;
-};
\ No newline at end of file
+    float dc[LANES];
+};
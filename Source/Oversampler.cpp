@@ -0,0 +1,209 @@
+/*
+  ==============================================================================
+
+    Oversampler.cpp
+    Created: 18 Oct 2026 10:21:06am
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#include "Oversampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Zeroth order modified Bessel function, for the Kaiser window
+static double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50 && term > 1e-12 * sum; ++k) {
+        double t = x / (2.0 * k);
+        term *= t * t;
+        sum += term;
+    }
+    return sum;
+}
+
+int HalfbandKernel::pairsFor(float transition, float attenuation)
+{
+    // Kaiser's estimate of the length, rounded up to 4 * pairs - 1
+    float taps = (attenuation - 7.95f) / (14.36f * transition) + 1.0f;
+    return std::max(1, int(std::ceil((taps + 1.0f) / 4.0f)));
+}
+
+void HalfbandKernel::design(float transition, float attenuation)
+{
+    const double PI = 3.14159265358979323846;
+
+    int pairs = pairsFor(transition, attenuation);
+    double centre = double(2 * pairs - 1); // distance to the outer taps
+    double beta = 0.1102 * (double(attenuation) - 8.7);
+
+    // Windowed sinc with its cutoff at a quarter of the input rate
+    coeffs.resize(size_t(pairs));
+    double sum = 0.0;
+    for (int k = 0; k < pairs; ++k) {
+        double d = double(2 * k + 1);
+        double sinc = std::sin(PI * d * 0.5) / (PI * d);
+        double x = d / centre;
+        double window = besselI0(beta * std::sqrt(1.0 - x * x)) / besselI0(beta);
+        coeffs[size_t(k)] = float(sinc * window);
+        sum += sinc * window;
+    }
+
+    // Gain of 1 at DC, the centre tap gives one half and the pairs the other
+    for (float& c : coeffs) {
+        c = float(double(c) * 0.25 / sum);
+    }
+}
+
+void HalfbandDecimator::allocate(int maxPairs, int maxOutputSamples)
+{
+    size_t size = size_t(2 * maxPairs - 1 + maxOutputSamples);
+    even.assign(size, 0.0f);
+    odd.assign(size, 0.0f);
+}
+
+void HalfbandDecimator::setKernel(const HalfbandKernel* newKernel)
+{
+    kernel = newKernel;
+    history = 2 * int(kernel->coeffs.size()) - 1;
+    reset();
+}
+
+void HalfbandDecimator::reset()
+{
+    std::fill(even.begin(), even.end(), 0.0f);
+    std::fill(odd.begin(), odd.end(), 0.0f);
+}
+
+void HalfbandDecimator::process(const float* input, float* output, int outputCount)
+{
+    const int pairs = int(kernel->coeffs.size());
+    const float* coeffs = kernel->coeffs.data();
+    float* e = even.data();
+    float* o = odd.data();
+
+    // Split the new samples between the branches, after the history
+    for (int m = 0; m < outputCount; ++m) {
+        e[history + m] = input[2 * m];
+        o[history + m] = input[2 * m + 1];
+    }
+
+    // The odd branch lines up with the centre tap
+    for (int m = 0; m < outputCount; ++m) {
+        output[m] = 0.5f * o[m + pairs - 1];
+    }
+
+    // The even branch gets the symmetric pairs, one tap at a time
+    for (int k = 0; k < pairs; ++k) {
+        const float c = coeffs[k];
+        const float* before = e + pairs - 1 - k;
+        const float* after = e + pairs + k;
+        for (int m = 0; m < outputCount; ++m) {
+            output[m] += c * (before[m] + after[m]);
+        }
+    }
+
+    // Keep the end of the block for the next one
+    std::memmove(e, e + outputCount, size_t(history) * sizeof(float));
+    std::memmove(o, o + outputCount, size_t(history) * sizeof(float));
+}
+
+float Oversampler::transitionFor(int stage, int quality)
+{
+    // Normal keeps the host band flat to 0.83 of Nyquist, High to 0.9. The
+    // last stage can fold nothing into that band, the first stage of 4x
+    // only has to keep it clear of what the last stage passes.
+    float passband = (quality == 0) ? 0.83f : 0.9f;
+    return (stage == 0) ? (1.0f - passband) / 2.0f : (2.0f - passband) / 4.0f;
+}
+
+float Oversampler::attenuationFor(int quality)
+{
+    return (quality == 0) ? 80.0f : 100.0f;
+}
+
+void Oversampler::allocate(int maxOutputSamples)
+{
+    for (int stage = 0; stage < 2; ++stage) {
+        int maxPairs = 1;
+        for (int q = 0; q < NUM_QUALITIES; ++q) {
+            kernels[q][stage].design(transitionFor(stage, q), attenuationFor(q));
+            maxPairs = std::max(maxPairs, int(kernels[q][stage].coeffs.size()));
+        }
+        // The first stage of 4x works at twice the rate of the last one
+        for (HalfbandDecimator& decimator : stages[stage]) {
+            decimator.allocate(maxPairs, maxOutputSamples << stage);
+        }
+    }
+
+    factor = 0; // make setup() pick the kernels
+    setup(1, 0);
+}
+
+void Oversampler::setup(int newFactor, int newQuality)
+{
+    if (newFactor == factor && newQuality == quality) { return; }
+    factor = newFactor;
+    quality = newQuality;
+
+    for (int stage = 0; stage < 2; ++stage) {
+        for (HalfbandDecimator& decimator : stages[stage]) {
+            decimator.setKernel(&kernels[quality][stage]);
+        }
+    }
+}
+
+void Oversampler::reset()
+{
+    for (auto& stage : stages) {
+        for (HalfbandDecimator& decimator : stage) {
+            decimator.reset();
+        }
+    }
+}
+
+void Oversampler::process(float* left, float* right, int outputCount)
+{
+    if (factor == 4) {
+        stages[1][0].process(left, left, outputCount * 2);
+        stages[1][1].process(right, right, outputCount * 2);
+    }
+    if (factor >= 2) {
+        stages[0][0].process(left, left, outputCount);
+        stages[0][1].process(right, right, outputCount);
+    }
+}
+
+int Oversampler::getTailLength() const
+{
+    // Each stage keeps 2 * pairs - 1 input samples
+    int tail = 0;
+    if (factor >= 2) {
+        int history = 2 * int(kernels[quality][0].coeffs.size()) - 1;
+        tail += (history + 1) / 2;
+    }
+    if (factor == 4) {
+        int history = 2 * int(kernels[quality][1].coeffs.size()) - 1;
+        tail += (history + 3) / 4;
+    }
+    return tail;
+}
+
+float Oversampler::getLatency(int factor, int quality)
+{
+    // A stage delays by half its length, 2 * pairs - 1 input samples
+    float latency = 0.0f;
+    if (factor >= 2) {
+        int pairs = HalfbandKernel::pairsFor(transitionFor(0, quality), attenuationFor(quality));
+        latency += float(2 * pairs - 1) / 2.0f;
+    }
+    if (factor == 4) {
+        int pairs = HalfbandKernel::pairsFor(transitionFor(1, quality), attenuationFor(quality));
+        latency += float(2 * pairs - 1) / 4.0f;
+    }
+    return latency;
+}
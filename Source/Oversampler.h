@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    Oversampler.h
+    Created: 18 Oct 2026 10:21:06am
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <vector>
+
+// Coefficients of a halfband lowpass with 4 * pairs - 1 taps. Apart from the
+// centre tap of 0.5, only the taps an odd distance from the centre are
+// non-zero. They're symmetric, so only one side is stored.
+struct HalfbandKernel
+{
+    // transition is the width of the transition band as a fraction of the
+    // input rate, attenuation is the stopband attenuation in dB
+    void design(float transition, float attenuation);
+
+    // Taps needed for a design, it grows as the transition gets narrower
+    static int pairsFor(float transition, float attenuation);
+
+    std::vector<float> coeffs; // coeffs[k] is the tap 2k + 1 away from the centre
+};
+
+// Halves the sample rate of one channel. The even and odd input samples are
+// kept apart (the two polyphase branches), so every tap is one contiguous
+// loop over the block and the odd branch only needs the centre tap.
+class HalfbandDecimator
+{
+public:
+    void allocate(int maxPairs, int maxOutputSamples);
+    void setKernel(const HalfbandKernel* newKernel);
+    void reset();
+
+    // Reads 2 * outputCount samples. output may be the same buffer as input.
+    void process(const float* input, float* output, int outputCount);
+
+private:
+    const HalfbandKernel* kernel = nullptr;
+    int history = 0; // samples of each branch kept from the last block
+    std::vector<float> even, odd;
+};
+
+// Brings the voice sum down from the oversampled rate to the host rate, 2x
+// at a time. The kernels for every factor and quality are designed up front,
+// so both can change on the audio thread without allocating.
+class Oversampler
+{
+public:
+    static constexpr int MAX_FACTOR = 4;
+    static constexpr int NUM_QUALITIES = 2; // 0 = Normal, 1 = High
+
+    void allocate(int maxOutputSamples);
+    void setup(int newFactor, int newQuality);
+    void reset();
+
+    int getFactor() const { return factor; }
+
+    // left and right hold factor * outputCount samples, the first
+    // outputCount are overwritten with the result
+    void process(float* left, float* right, int outputCount);
+
+    // Delay of the filters, in samples at the host rate
+    static float getLatency(int factor, int quality);
+
+    // Host samples of silence it takes to flush the filters, after that
+    // the output stays zero until there's input again
+    int getTailLength() const;
+
+private:
+    // The last stage has to be steep. The first stage of 4x has a lot of
+    // room, everything it lets through is removed by the last stage.
+    static float transitionFor(int stage, int quality);
+    static float attenuationFor(int quality);
+
+    HalfbandKernel kernels[NUM_QUALITIES][2]; // [quality][stage], 0 = last stage
+    HalfbandDecimator stages[2][2]; // [stage][channel]
+    int factor = 1;
+    int quality = 0;
+};
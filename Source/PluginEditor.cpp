@@ -25,17 +25,68 @@ JX11AudioProcessorEditor::JX11AudioProcessorEditor (JX11AudioProcessor& p)
     polyModeButton.setClickingTogglesState(true);
     addAndMakeVisible(polyModeButton);
 
-    setSize (600, 400);
+    addAndMakeVisible(parameterPanel);
+
+    setSize (600, 900);
+
+    // The meter is the load meter's only reader while the editor is open
+    startTimerHz(10);
 }
 
 JX11AudioProcessorEditor::~JX11AudioProcessorEditor()
 {
+    stopTimer();
+}
+
+void JX11AudioProcessorEditor::timerCallback()
+{
+    loadSummary = audioProcessor.getLoadMeter().update();
+    audioProcessor.getSafetyCounts(silencedBuffers, clampedBuffers);
+    repaint(meterArea);
 }
 
 //==============================================================================
 void JX11AudioProcessorEditor::paint (juce::Graphics& g)
 {
     g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
+    paintLoadMeter(g);
+}
+
+void JX11AudioProcessorEditor::paintLoadMeter(juce::Graphics& g)
+{
+    auto area = meterArea;
+    g.setColour(juce::Colours::white);
+    g.setFont(14.0f);
+
+    auto line = [&](const juce::String& text)
+    {
+        g.drawText(text, area.removeFromTop(18), juce::Justification::centredLeft);
+    };
+    line("CPU " + juce::String(loadSummary.load * 100.0, 1) + " %, worst block "
+        + juce::String(loadSummary.peakLoad * 100.0, 0) + " %, "
+        + juce::String(loadSummary.overruns) + " of " + juce::String(loadSummary.blocks) + " blocks over budget");
+    line("Block time p50 " + juce::String(loadSummary.p50, 1) + " us, p99 "
+        + juce::String(loadSummary.p99, 1) + " us, max " + juce::String(loadSummary.max, 1) + " us");
+    line("Output muted " + juce::String(silencedBuffers) + "x, clipped " + juce::String(clampedBuffers) + "x");
+
+    // Histogram of the load per block, the tallest bar fills the height
+    area.removeFromTop(6);
+    auto labels = area.removeFromBottom(16);
+    int tallest = 1;
+    for (int count : loadSummary.histogram) { tallest = std::max(tallest, count); }
+    const int barWidth = area.getWidth() / LoadMeter::NUM_BUCKETS;
+    g.setFont(11.0f);
+    for (int bucket = 0; bucket < LoadMeter::NUM_BUCKETS; ++bucket) {
+        auto column = area.withX(area.getX() + bucket * barWidth).withWidth(barWidth - 2);
+        int height = column.getHeight() * loadSummary.histogram[bucket] / tallest;
+        g.setColour(LoadMeter::bucketStart(bucket) >= 1.0 ? juce::Colours::orangered : juce::Colours::lightgreen);
+        g.fillRect(column.removeFromBottom(height));
+
+        g.setColour(juce::Colours::white);
+        g.drawText(juce::String(juce::roundToInt(LoadMeter::bucketStart(bucket) * 100.0)) + "%",
+            labels.withX(labels.getX() + bucket * barWidth).withWidth(barWidth),
+            juce::Justification::centred);
+    }
 }
 
 void JX11AudioProcessorEditor::resized()
@@ -51,4 +102,9 @@ void JX11AudioProcessorEditor::resized()
     r = r.withY(r.getBottom());
     polyModeButton.setSize(80, 30);
     polyModeButton.setCentrePosition({ r.getX(), r.getCentreY() });
+
+    auto area = getLocalBounds().reduced(20);
+    meterArea = area.removeFromBottom(170);
+    area.setTop(r.getBottom());
+    parameterPanel.setBounds(area.withTrimmedBottom(20));
 }
@@ -14,7 +14,8 @@
 //==============================================================================
 /**
 */
-class JX11AudioProcessorEditor  : public juce::AudioProcessorEditor
+class JX11AudioProcessorEditor  : public juce::AudioProcessorEditor,
+    private juce::Timer
 {
 public:
     JX11AudioProcessorEditor (JX11AudioProcessor&);
@@ -26,6 +27,16 @@ public:
 
 private:
 
+    void timerCallback() override;
+
+    // CPU load of processBlock and what the output safety stage did,
+    // refreshed by the timer
+    void paintLoadMeter(juce::Graphics& g);
+    juce::Rectangle<int> meterArea;
+    LoadMeter::Summary loadSummary;
+    uint32_t silencedBuffers = 0;
+    uint32_t clampedBuffers = 0;
+
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     JX11AudioProcessor& audioProcessor;
@@ -47,5 +58,8 @@ private:
     ButtonAttachment polyModeAttachment{ audioProcessor.apvts,
               ParameterID::polyMode.getParamID(), polyModeButton };
 
+    // Every parameter, so the ones without a knob above stay editable
+    juce::GenericAudioProcessorEditor parameterPanel{ audioProcessor };
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (JX11AudioProcessorEditor)
 };
@@ -9,6 +9,7 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 #include "Utils.h"
+#include "SynthParameters.h"
 
 //==============================================================================
 JX11AudioProcessor::JX11AudioProcessor()
@@ -49,17 +50,77 @@ JX11AudioProcessor::JX11AudioProcessor()
     castParameter(apvts, ParameterID::tuning, tuningParam);
     castParameter(apvts, ParameterID::outputLevel, outputLevelParam);
     castParameter(apvts, ParameterID::polyMode, polyModeParam);
+    castParameter(apvts, ParameterID::voices, voicesParam);
+    castParameter(apvts, ParameterID::oscEngine, oscEngineParam);
+    castParameter(apvts, ParameterID::unison, unisonParam);
+    castParameter(apvts, ParameterID::unisonDetune, unisonDetuneParam);
+    castParameter(apvts, ParameterID::unisonWidth, unisonWidthParam);
+    castParameter(apvts, ParameterID::renderThreads, renderThreadsParam);
+    castParameter(apvts, ParameterID::oversampling, oversamplingParam);
+    castParameter(apvts, ParameterID::oversamplingQuality, oversamplingQualityParam);
+    castParameter(apvts, ParameterID::controlRate, controlRateParam);
+    castParameter(apvts, ParameterID::controlInterpolation, controlInterpolationParam);
+    castParameter(apvts, ParameterID::multiTimbral, multiTimbralParam);
+    castParameter(apvts, ParameterID::midiGrid, midiGridParam);
+
+    // The parameters stored in presets, in the order of Preset::param
+    juce::RangedAudioParameter* params[NUM_PARAMS] = {
+        oscMixParam,
+        oscTuneParam,
+        oscFineParam,
+        glideModeParam,
+        glideRateParam,
+        glideBendParam,
+        filterFreqParam,
+        filterResoParam,
+        filterEnvParam,
+        filterLFOParam,
+        filterVelocityParam,
+        filterAttackParam,
+        filterDecayParam,
+        filterSustainParam,
+        filterReleaseParam,
+        envAttackParam,
+        envDecayParam,
+        envSustainParam,
+        envReleaseParam,
+        lfoRateParam,
+        vibratoParam,
+        noiseParam,
+        octaveParam,
+        tuningParam,
+        outputLevelParam,
+        polyModeParam,
+        voicesParam,
+        oscEngineParam,
+        unisonParam,
+        unisonDetuneParam,
+        unisonWidthParam,
+    };
+    std::copy(params, params + NUM_PARAMS, presetParams);
+
+    for (int i = 0; i < NUM_STATE_PARAMS; ++i) {
+        stateParams[i] = apvts.getParameter(STATE_PARAMETER_IDS[i]);
+        jassert(stateParams[i] != nullptr && (i >= NUM_PARAMS || stateParams[i] == presetParams[i]));
+    }
+    jassert(getParameters().size() == NUM_STATE_PARAMS); // a new parameter needs a place in the state
 
     apvts.state.addListener(this); // Connect valueTreePropertyChanged with apvts
 
-    // Create presets and init to first preset
-    createPrograms();
-    setCurrentProgram(0);
+    // Init to first preset
+    loadProgramParameters(0);
+    for (PartSettings& part : partSettings) {
+        part.outputLevel.store(FACTORY_PRESETS[0].param[PARAM_OUTPUT_LEVEL]);
+    }
+
+    startTimerHz(MIDI_POLL_HZ);
 }
 
 JX11AudioProcessor::~JX11AudioProcessor()
 {
+    stopTimer();
     apvts.state.removeListener(this);
+    cancelPendingUpdate();
 }
 
 //==============================================================================
@@ -97,126 +158,46 @@ bool JX11AudioProcessor::isMidiEffect() const
 
 double JX11AudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return tailLength.load();
 }
 
 int JX11AudioProcessor::getNumPrograms()
 {
-    return int(presets.size());
+    return NUM_FACTORY_PRESETS;
 }
 
 int JX11AudioProcessor::getCurrentProgram()
 {
-    return currentProgram;
+    return currentProgram.load();
 }
 
 void JX11AudioProcessor::setCurrentProgram (int index)
 {
-    // Update current program
-    currentProgram = index;
-
+    // The audio thread switches to the preset's settings at its next block,
+    // the parameters follow when the timer notices the request. Only the
+    // newest request counts. Hosts may call this on the audio thread, so
+    // no lock and no message.
+    currentProgram.store(index);
+    uint32_t request = programRequest.load();
+    while (!programRequest.compare_exchange_weak(request, (((request >> 8) + 1) << 8) | uint32_t(index))) {}
+}
 
-    juce::RangedAudioParameter* params[NUM_PARAMS] = {
-        oscMixParam,
-        oscTuneParam,
-        oscFineParam,
-        glideModeParam,
-        glideRateParam,
-        glideBendParam,
-        filterFreqParam,
-        filterResoParam,
-        filterEnvParam,
-        filterLFOParam,
-        filterVelocityParam,
-        filterAttackParam,
-        filterDecayParam,
-        filterSustainParam,
-        filterReleaseParam,
-        envAttackParam,
-        envDecayParam,
-        envSustainParam,
-        envReleaseParam,
-        lfoRateParam,
-        vibratoParam,
-        noiseParam,
-        octaveParam,
-        tuningParam,
-        outputLevelParam,
-        polyModeParam,
-    };
+void JX11AudioProcessor::loadProgramParameters(int index)
+{
+    // Update current program
+    currentProgram.store(index);
 
-    const Preset& preset = presets[index];
+    const Preset& preset = FACTORY_PRESETS[index];
 
     // Iterate through params & update each value
     for (int i = 0; i < NUM_PARAMS; ++i) {
-        params[i]->setValueNotifyingHost(params[i]->convertTo0to1(preset.param[i]));
+        presetParams[i]->setValueNotifyingHost(presetParams[i]->convertTo0to1(preset.param[i]));
     }
-
-    // This is needed because changing presets while playing notes may need to
-    // invalid filter states etc, which can give nan or inf in the audio buffer.
-    reset();
-}
-
-void JX11AudioProcessor::createPrograms()
-{
-    presets.emplace_back("Init", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 100.00f, 15.00f, 50.00f, 0.00f, 0.00f, 0.00f, 30.00f, 0.00f, 25.00f, 0.00f, 50.00f, 100.00f, 30.00f, 0.81f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("5th Sweep Pad", 100.00f, -7.00f, -6.30f, 1.00f, 32.00f, 0.00f, 90.00f, 60.00f, -76.00f, 0.00f, 0.00f, 90.00f, 89.00f, 90.00f, 73.00f, 0.00f, 50.00f, 100.00f, 71.00f, 0.81f, 30.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Echo Pad [SA]", 88.00f, 0.00f, 0.00f, 0.00f, 49.00f, 0.00f, 46.00f, 76.00f, 38.00f, 10.00f, 38.00f, 100.00f, 86.00f, 76.00f, 57.00f, 30.00f, 80.00f, 68.00f, 66.00f, 0.79f, -74.00f, 25.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Space Chimes [SA]", 88.00f, 0.00f, 0.00f, 0.00f, 49.00f, 0.00f, 49.00f, 82.00f, 32.00f, 8.00f, 78.00f, 85.00f, 69.00f, 76.00f, 47.00f, 12.00f, 22.00f, 55.00f, 66.00f, 0.89f, -32.00f, 0.00f, 2.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Solid Backing", 100.00f, -12.00f, -18.70f, 0.00f, 35.00f, 0.00f, 30.00f, 25.00f, 40.00f, 0.00f, 26.00f, 0.00f, 35.00f, 0.00f, 25.00f, 0.00f, 50.00f, 100.00f, 30.00f, 0.81f, 0.00f, 50.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Velocity Backing [SA]", 41.00f, 0.00f, 9.70f, 0.00f, 8.00f, -1.68f, 49.00f, 1.00f, -32.00f, 0.00f, 86.00f, 61.00f, 87.00f, 100.00f, 93.00f, 11.00f, 48.00f, 98.00f, 32.00f, 0.81f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Rubber Backing [ZF]", 29.00f, 12.00f, -5.60f, 0.00f, 18.00f, 5.06f, 35.00f, 15.00f, 54.00f, 14.00f, 8.00f, 0.00f, 42.00f, 13.00f, 21.00f, 0.00f, 56.00f, 0.00f, 32.00f, 0.20f, 16.00f, 22.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("808 State Lead", 100.00f, 7.00f, -7.10f, 2.00f, 34.00f, 12.35f, 65.00f, 63.00f, 50.00f, 16.00f, 0.00f, 0.00f, 30.00f, 0.00f, 25.00f, 17.00f, 50.00f, 100.00f, 3.00f, 0.81f, 0.00f, 0.00f, 1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Mono Glide", 0.00f, -12.00f, 0.00f, 2.00f, 46.00f, 0.00f, 51.00f, 0.00f, 0.00f, 0.00f, -100.00f, 0.00f, 30.00f, 0.00f, 25.00f, 37.00f, 50.00f, 100.00f, 38.00f, 0.81f, 24.00f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Detuned Techno Lead", 84.00f, 0.00f, -17.20f, 2.00f, 41.00f, -0.15f, 54.00f, 1.00f, 16.00f, 21.00f, 34.00f, 0.00f, 9.00f, 100.00f, 25.00f, 20.00f, 85.00f, 100.00f, 30.00f, 0.83f, -82.00f, 40.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Hard Lead [SA]", 71.00f, 12.00f, 0.00f, 0.00f, 24.00f, 36.00f, 56.00f, 52.00f, 38.00f, 19.00f, 40.00f, 100.00f, 14.00f, 65.00f, 95.00f, 7.00f, 91.00f, 100.00f, 15.00f, 0.84f, -34.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Bubble", 0.00f, -12.00f, -0.20f, 0.00f, 71.00f, -0.00f, 23.00f, 77.00f, 60.00f, 32.00f, 26.00f, 40.00f, 18.00f, 66.00f, 14.00f, 0.00f, 38.00f, 65.00f, 16.00f, 0.48f, 0.00f, 0.00f, 1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Monosynth", 62.00f, -12.00f, 0.00f, 1.00f, 35.00f, 0.02f, 64.00f, 39.00f, 2.00f, 65.00f, -100.00f, 7.00f, 52.00f, 24.00f, 84.00f, 13.00f, 30.00f, 76.00f, 21.00f, 0.58f, -40.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Moogcury Lite", 81.00f, 24.00f, -9.80f, 1.00f, 15.00f, -0.97f, 39.00f, 17.00f, 38.00f, 40.00f, 24.00f, 0.00f, 47.00f, 19.00f, 37.00f, 0.00f, 50.00f, 20.00f, 33.00f, 0.38f, 6.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Gangsta Whine", 0.00f, 0.00f, 0.00f, 2.00f, 44.00f, 0.00f, 41.00f, 46.00f, 0.00f, 0.00f, -100.00f, 0.00f, 0.00f, 100.00f, 25.00f, 15.00f, 50.00f, 100.00f, 32.00f, 0.81f, -2.00f, 0.00f, 2.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Higher Synth [ZF]", 48.00f, 0.00f, -8.80f, 0.00f, 0.00f, 0.00f, 50.00f, 47.00f, 46.00f, 30.00f, 60.00f, 0.00f, 10.00f, 0.00f, 7.00f, 0.00f, 42.00f, 0.00f, 22.00f, 0.21f, 18.00f, 16.00f, 2.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("303 Saw Bass", 0.00f, 0.00f, 0.00f, 1.00f, 49.00f, 0.00f, 55.00f, 75.00f, 38.00f, 35.00f, 0.00f, 0.00f, 56.00f, 0.00f, 56.00f, 0.00f, 80.00f, 100.00f, 24.00f, 0.26f, -2.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("303 Square Bass", 75.00f, 0.00f, 0.00f, 1.00f, 49.00f, 0.00f, 55.00f, 75.00f, 38.00f, 35.00f, 0.00f, 14.00f, 49.00f, 0.00f, 39.00f, 0.00f, 80.00f, 100.00f, 24.00f, 0.26f, -2.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Analog Bass", 100.00f, -12.00f, -10.90f, 1.00f, 19.00f, 0.00f, 30.00f, 51.00f, 70.00f, 9.00f, -100.00f, 0.00f, 88.00f, 0.00f, 21.00f, 0.00f, 50.00f, 100.00f, 46.00f, 0.81f, 0.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Analog Bass 2", 100.00f, -12.00f, -10.90f, 0.00f, 19.00f, 13.44f, 48.00f, 43.00f, 88.00f, 0.00f, 60.00f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 61.00f, 100.00f, 32.00f, 0.81f, 0.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Low Pulses", 97.00f, -12.00f, -3.30f, 0.00f, 35.00f, 0.00f, 80.00f, 40.00f, 4.00f, 0.00f, 0.00f, 0.00f, 77.00f, 0.00f, 25.00f, 0.00f, 50.00f, 100.00f, 30.00f, 0.81f, -68.00f, 0.00f, -2.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Sine Infra-Bass", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 33.00f, 76.00f, 6.00f, 0.00f, 0.00f, 0.00f, 30.00f, 0.00f, 25.00f, 0.00f, 55.00f, 25.00f, 30.00f, 0.81f, 4.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Wobble Bass [SA]", 100.00f, -12.00f, -8.80f, 0.00f, 82.00f, 0.21f, 72.00f, 47.00f, -32.00f, 34.00f, 64.00f, 20.00f, 69.00f, 100.00f, 15.00f, 9.00f, 50.00f, 100.00f, 7.00f, 0.81f, -8.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Squelch Bass", 100.00f, -12.00f, -8.80f, 0.00f, 35.00f, 0.00f, 67.00f, 70.00f, -48.00f, 0.00f, 0.00f, 48.00f, 69.00f, 100.00f, 15.00f, 0.00f, 50.00f, 100.00f, 7.00f, 0.81f, -8.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Rubber Bass [ZF]", 49.00f, -12.00f, 1.60f, 1.00f, 35.00f, 0.00f, 36.00f, 15.00f, 50.00f, 20.00f, 0.00f, 0.00f, 38.00f, 0.00f, 25.00f, 0.00f, 60.00f, 100.00f, 22.00f, 0.19f, 0.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Soft Pick Bass", 37.00f, 0.00f, 7.80f, 0.00f, 22.00f, 0.00f, 33.00f, 47.00f, 42.00f, 16.00f, 18.00f, 0.00f, 0.00f, 0.00f, 25.00f, 4.00f, 58.00f, 0.00f, 22.00f, 0.15f, -12.00f, 33.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Fretless Bass", 50.00f, 0.00f, -14.40f, 1.00f, 34.00f, 0.00f, 51.00f, 0.00f, 16.00f, 0.00f, 34.00f, 0.00f, 9.00f, 0.00f, 25.00f, 20.00f, 85.00f, 0.00f, 30.00f, 0.81f, 40.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Whistler", 23.00f, 0.00f, -0.70f, 0.00f, 35.00f, 0.00f, 33.00f, 100.00f, 0.00f, 0.00f, 0.00f, 0.00f, 29.00f, 0.00f, 25.00f, 68.00f, 39.00f, 58.00f, 36.00f, 0.81f, 28.00f, 38.00f, 2.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Very Soft Pad", 39.00f, 0.00f, -4.90f, 2.00f, 12.00f, 0.00f, 35.00f, 78.00f, 0.00f, 0.00f, 0.00f, 0.00f, 30.00f, 0.00f, 25.00f, 35.00f, 50.00f, 80.00f, 70.00f, 0.81f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Pizzicato", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 23.00f, 20.00f, 50.00f, 0.00f, 0.00f, 0.00f, 22.00f, 0.00f, 25.00f, 0.00f, 47.00f, 0.00f, 30.00f, 0.81f, 0.00f, 80.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Synth Strings", 100.00f, 0.00f, -7.10f, 0.00f, 0.00f, -0.97f, 42.00f, 26.00f, 50.00f, 14.00f, 38.00f, 0.00f, 67.00f, 55.00f, 97.00f, 82.00f, 70.00f, 100.00f, 42.00f, 0.84f, 34.00f, 30.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Synth Strings 2", 75.00f, 0.00f, -3.80f, 0.00f, 49.00f, 0.00f, 55.00f, 16.00f, 38.00f, 8.00f, -60.00f, 76.00f, 29.00f, 76.00f, 100.00f, 46.00f, 80.00f, 100.00f, 39.00f, 0.79f, -46.00f, 0.00f, 1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Leslie Organ", 0.00f, 0.00f, 0.00f, 0.00f, 13.00f, -0.38f, 38.00f, 74.00f, 8.00f, 20.00f, -100.00f, 0.00f, 55.00f, 52.00f, 31.00f, 0.00f, 17.00f, 73.00f, 28.00f, 0.87f, -52.00f, 0.00f, -1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Click Organ", 50.00f, 12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 44.00f, 50.00f, 30.00f, 16.00f, -100.00f, 0.00f, 0.00f, 18.00f, 0.00f, 0.00f, 75.00f, 80.00f, 0.00f, 0.81f, -2.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Hard Organ", 89.00f, 19.00f, -0.90f, 0.00f, 35.00f, 0.00f, 51.00f, 62.00f, 8.00f, 0.00f, -100.00f, 0.00f, 37.00f, 0.00f, 100.00f, 4.00f, 8.00f, 72.00f, 4.00f, 0.77f, -2.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Bass Clarinet", 100.00f, 0.00f, 0.00f, 1.00f, 0.00f, 0.00f, 51.00f, 10.00f, 0.00f, 11.00f, 0.00f, 0.00f, 0.00f, 0.00f, 25.00f, 35.00f, 65.00f, 65.00f, 32.00f, 0.79f, -2.00f, 20.00f, -1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Trumpet", 0.00f, 0.00f, 0.00f, 1.00f, 6.00f, 0.00f, 57.00f, 0.00f, -36.00f, 15.00f, 0.00f, 21.00f, 15.00f, 0.00f, 25.00f, 24.00f, 60.00f, 80.00f, 10.00f, 0.75f, 10.00f, 25.00f, 1.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Soft Horn", 12.00f, 19.00f, 1.90f, 0.00f, 35.00f, 0.00f, 50.00f, 21.00f, -42.00f, 12.00f, 20.00f, 0.00f, 35.00f, 36.00f, 25.00f, 8.00f, 50.00f, 100.00f, 27.00f, 0.83f, 2.00f, 10.00f, -1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Brass Section", 43.00f, 12.00f, -7.90f, 0.00f, 28.00f, -0.79f, 50.00f, 0.00f, 18.00f, 0.00f, 0.00f, 24.00f, 16.00f, 91.00f, 8.00f, 17.00f, 50.00f, 80.00f, 45.00f, 0.81f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Synth Brass", 40.00f, 0.00f, -6.30f, 0.00f, 30.00f, -3.07f, 39.00f, 15.00f, 50.00f, 0.00f, 0.00f, 39.00f, 30.00f, 82.00f, 25.00f, 33.00f, 74.00f, 76.00f, 41.00f, 0.81f, -6.00f, 23.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Detuned Syn Brass [ZF]", 68.00f, 0.00f, 31.80f, 0.00f, 31.00f, 0.50f, 26.00f, 7.00f, 70.00f, 0.00f, 32.00f, 0.00f, 83.00f, 0.00f, 5.00f, 0.00f, 75.00f, 54.00f, 32.00f, 0.76f, -26.00f, 29.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Power PWM", 100.00f, -12.00f, -8.80f, 0.00f, 35.00f, 0.00f, 82.00f, 13.00f, 50.00f, 0.00f, -100.00f, 24.00f, 30.00f, 88.00f, 34.00f, 0.00f, 50.00f, 100.00f, 48.00f, 0.71f, -26.00f, 0.00f, -1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Water Velocity [SA]", 76.00f, 0.00f, -1.40f, 0.00f, 49.00f, 0.00f, 87.00f, 67.00f, 100.00f, 32.00f, -82.00f, 95.00f, 56.00f, 72.00f, 100.00f, 4.00f, 76.00f, 11.00f, 46.00f, 0.88f, 44.00f, 0.00f, -1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Ghost [SA]", 75.00f, 0.00f, -7.10f, 2.00f, 16.00f, -0.00f, 38.00f, 58.00f, 50.00f, 16.00f, 62.00f, 0.00f, 30.00f, 40.00f, 31.00f, 37.00f, 50.00f, 100.00f, 54.00f, 0.85f, 66.00f, 43.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Soft E.Piano", 31.00f, 0.00f, -0.20f, 0.00f, 35.00f, 0.00f, 34.00f, 26.00f, 6.00f, 0.00f, 26.00f, 0.00f, 22.00f, 0.00f, 39.00f, 0.00f, 80.00f, 0.00f, 44.00f, 0.81f, 2.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Thumb Piano", 72.00f, 15.00f, 50.00f, 0.00f, 35.00f, 0.00f, 37.00f, 47.00f, 8.00f, 0.00f, 0.00f, 0.00f, 45.00f, 0.00f, 39.00f, 0.00f, 39.00f, 0.00f, 48.00f, 0.81f, 20.00f, 0.00f, 1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Steel Drums [ZF]", 81.00f, 12.00f, -12.00f, 0.00f, 18.00f, 2.30f, 40.00f, 30.00f, 8.00f, 17.00f, -20.00f, 0.00f, 42.00f, 23.00f, 47.00f, 12.00f, 48.00f, 0.00f, 49.00f, 0.53f, -28.00f, 34.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Car Horn", 57.00f, -1.00f, -2.80f, 0.00f, 35.00f, 0.00f, 46.00f, 0.00f, 36.00f, 0.00f, 0.00f, 46.00f, 30.00f, 100.00f, 23.00f, 30.00f, 50.00f, 100.00f, 31.00f, 1.00f, -24.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Helicopter", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 8.00f, 36.00f, 38.00f, 100.00f, 0.00f, 100.00f, 100.00f, 0.00f, 100.00f, 96.00f, 50.00f, 100.00f, 92.00f, 0.97f, 0.00f, 100.00f, -2.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Arctic Wind", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 16.00f, 85.00f, 0.00f, 28.00f, 0.00f, 37.00f, 30.00f, 0.00f, 25.00f, 89.00f, 50.00f, 100.00f, 89.00f, 0.24f, 0.00f, 100.00f, 2.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Thip", 100.00f, -7.00f, 0.00f, 0.00f, 35.00f, 0.00f, 0.00f, 100.00f, 94.00f, 0.00f, 0.00f, 2.00f, 20.00f, 0.00f, 20.00f, 0.00f, 46.00f, 0.00f, 30.00f, 0.81f, 0.00f, 78.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Synth Tom", 0.00f, -12.00f, 0.00f, 0.00f, 76.00f, 24.53f, 30.00f, 33.00f, 52.00f, 0.00f, 36.00f, 0.00f, 59.00f, 0.00f, 59.00f, 10.00f, 50.00f, 0.00f, 50.00f, 0.81f, 0.00f, 70.00f, -2.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Squelchy Frog", 50.00f, -5.00f, -7.90f, 2.00f, 77.00f, -36.00f, 40.00f, 65.00f, 90.00f, 0.00f, 0.00f, 33.00f, 50.00f, 0.00f, 25.00f, 0.00f, 70.00f, 65.00f, 18.00f, 0.32f, 100.00f, 0.00f, -2.00f, 0.00f, 0.00f, 1.00f);
 }
 
 const juce::String JX11AudioProcessor::getProgramName (int index)
 {
-    return { presets[index].name };
+    return { FACTORY_PRESETS[index].name };
 }
 
 void JX11AudioProcessor::changeProgramName (int /*index*/, const juce::String& /*newName*/)
@@ -228,18 +209,84 @@ void JX11AudioProcessor::changeProgramName (int /*index*/, const juce::String& /
 void JX11AudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     synth.allocateResources(sampleRate, samplesPerBlock);
-    parametersChanged.store(true); // properly init params
+    loadMeter.prepare(sampleRate);
+    blockEvents.resize(MAX_BLOCK_EVENTS);
+    {
+        // The parts are sized for the block, publishSettings() allocates
+        // them again if the mode is on
+        const juce::ScopedLock lock(settingsLock);
+        settingsSampleRate = float(sampleRate);
+        settingsBlockSize = samplesPerBlock;
+        multiTimbral.store(false);
+        partsInUse.store(false);
+        multiSynth.deallocateResources();
+        partsAllocated.store(false);
+    }
+    dirtyParameters.store(~ParameterMask(0)); // properly init params
+    dirtyParts.store(~uint32_t(0));
+    publishSettings();
+
+    // The audio thread isn't running yet, so take the settings right away.
+    // reset() then starts the smoothed parameters at these values.
+    renderingParts = multiTimbral.load();
+    partsInUse.store(renderingParts);
+    takeSettings();
     reset();
 }
 
 void JX11AudioProcessor::releaseResources()
 {
     synth.deallocateResources();
+
+    // The audio thread has stopped, nothing is allocated until the next
+    // prepareToPlay()
+    const juce::ScopedLock lock(settingsLock);
+    settingsBlockSize = 0;
+    multiTimbral.store(false);
+    partsInUse.store(false);
+    multiSynth.deallocateResources();
+    partsAllocated.store(false);
+}
+
+void JX11AudioProcessor::updatePartResources(bool wanted)
+{
+    if (wanted && !partsAllocated.load() && settingsBlockSize > 0) {
+        multiSynth.allocateResources(settingsSampleRate, settingsBlockSize);
+        partsAllocated.store(true);
+    }
+    multiTimbral.store(wanted && partsAllocated.load());
+    if (!wanted && partsAllocated.load() && !partsInUse.load()) {
+        multiSynth.deallocateResources();
+        partsAllocated.store(false);
+    }
+}
+
+void JX11AudioProcessor::releaseUnusedParts()
+{
+    // Most of the time there's nothing to free, don't take the lock then
+    if (!partsAllocated.load() || multiTimbral.load() || partsInUse.load()) { return; }
+
+    // The mode may have been turned on again in the meantime
+    const juce::ScopedLock lock(settingsLock);
+    if (!multiTimbral.load()) {
+        updatePartResources(false);
+    }
 }
 
 void JX11AudioProcessor::reset()
+{
+    if (renderingParts) {
+        multiSynth.reset();
+    }
+    resetSynth();
+}
+
+void JX11AudioProcessor::resetSynth()
 {
     synth.reset();
+    if (renderingParts) {
+        multiSynth.resetPart(0);
+    }
     // Set initial value for smoothed slider
     synth.outputLevelSmoother.setCurrentAndTargetValue(
         juce::Decibels::decibelsToGain(outputLevelParam->get())
@@ -275,6 +322,7 @@ bool JX11AudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) con
 void JX11AudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
+    LoadMeter::Scope loadScope(loadMeter, buffer.getNumSamples());
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -282,33 +330,158 @@ void JX11AudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::M
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    // tread safe check to see if parameters changed
-    bool expected = true;
-    if (parametersChanged.compare_exchange_strong(expected, false)) {
-        update();
+    takeSettings();
+
+    // Switching modes stops every note, the other mode's voices won't be
+    // rendered anymore. The parts are only touched after partsInUse is set,
+    // and let go before it's cleared.
+    if (multiTimbral.load() != renderingParts) {
+        if (renderingParts) {
+            renderingParts = false;
+            reset();
+            partsInUse.store(false);
+        }
+        else {
+            partsInUse.store(true);
+            if (multiTimbral.load()) {
+                startParts();
+            }
+            else {
+                partsInUse.store(false);
+            }
+        }
     }
 
-    splitBufferByEvents(buffer, midiMessages);
+    if (renderingParts) {
+        renderParts(buffer, midiMessages);
+    }
+    else {
+        splitBufferByEvents(buffer, midiMessages);
+    }
+}
+
+void JX11AudioProcessor::takeSettings()
+{
+    // Take the newest settings, if any. They were worked out on another
+    // thread, so there's no parameter math to do here.
+    if (const std::vector<SynthSettings>* table = presetSettingsBuffer.acquire()) {
+        presetSettings = table;
+        if (programOverride >= 0) {
+            useSettings(&(*table)[size_t(programOverride)]);
+        }
+    }
+    uint32_t request = programRequest.load();
+    if ((request >> 8) != programRequestsTaken && presetSettings != nullptr) {
+        programRequestsTaken = request >> 8;
+        playProgram(int(request & 0xFF));
+    }
+    if (const SynthSettings* settings = settingsBuffer.acquire()) {
+        // Settings from before the message thread got to the last program
+        // or volume change would undo it
+        if (settings->midiChanges == midiChangesQueued
+            && settings->programRequests == programRequestsTaken) {
+            programOverride = -1;
+            volumeOverride = -1.0f;
+            useSettings(settings);
+        }
+        else if (programOverride < 0) {
+            useSettings(settings);
+        }
+    }
+    for (int part = 1; part < NUM_PARTS; ++part) {
+        if (const SynthSettings* settings = partSettings[part].settingsBuffer.acquire()) {
+            currentPartSettings[part] = settings;
+            if (renderingParts) {
+                multiSynth.setSettings(part, settings);
+            }
+        }
+    }
+}
+
+void JX11AudioProcessor::useSettings(const SynthSettings* settings)
+{
+    currentSettings = settings;
+    synth.setSettings(settings);
+    if (renderingParts) {
+        multiSynth.setSettings(0, settings);
+    }
+    renderThreads = settings->renderThreads;
+    if (volumeOverride >= 0.0f) {
+        synth.outputLevelSmoother.setTargetValue(volumeOverride);
+        if (renderingParts) {
+            multiSynth.setOutputLevel(0, volumeOverride);
+        }
+    }
+}
+
+void JX11AudioProcessor::startParts()
+{
+    // The parts were just allocated and have no settings yet
+    renderingParts = true;
+    for (int part = 1; part < NUM_PARTS; ++part) {
+        if (currentPartSettings[part] != nullptr) {
+            multiSynth.setSettings(part, currentPartSettings[part]);
+        }
+    }
+    if (currentSettings != nullptr) {
+        useSettings(currentSettings);
+    }
+    reset();
+}
+
+void JX11AudioProcessor::playProgram(int index)
+{
+    // Play the preset's settings until the parameters have it too
+    const SynthSettings* settings = &(*presetSettings)[size_t(index)];
+    programOverride = index;
+    volumeOverride = -1.0f;
+    useSettings(settings);
+
+    // Changing presets while playing notes may leave invalid filter states
+    // etc, which can give nan or inf in the audio buffer. Same as
+    // resetSynth(), but the level parameter isn't there yet.
+    synth.reset();
+    if (renderingParts) {
+        multiSynth.resetPart(0);
+    }
+    synth.outputLevelSmoother.setCurrentAndTargetValue(settings->outputLevel);
+}
+
+int JX11AudioProcessor::collectEvents(const juce::MidiBuffer& midiMessages)
+{
+    // A controller sweep would split the block into tiny segments, and
+    // could fill the buffer before the notes after it are in
+    EventCoalescer::Queue queue { blockEvents.data(), int(blockEvents.size()) };
+    int grid = midiGrid.load();
+
+    // Ignore MIDI messages such as sysex
+    for (const auto metadata : midiMessages) {
+        if (metadata.numBytes <= 3) {
+            uint8_t data1 = (metadata.numBytes >= 2) ? metadata.data[1] : 0;
+            uint8_t data2 = (metadata.numBytes == 3) ? metadata.data[2] : 0;
+            coalescer.add(queue, { metadata.samplePosition, metadata.data[0], data1, data2 }, grid);
+        }
+    }
+    return queue.numEvents;
 }
 
 void JX11AudioProcessor::splitBufferByEvents(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     int bufferOffset = 0;
 
-    for (const auto metadata : midiMessages) {
+    int numEvents = collectEvents(midiMessages);
+    for (int i = 0; i < numEvents; ++i) {
+        const MidiEvent& event = blockEvents[size_t(i)];
+
         // Render the audio that happens before this event (if any)
-        int samplesThisSegment = metadata.samplePosition - bufferOffset;
+        int samplesThisSegment = event.position - bufferOffset;
         if (samplesThisSegment > 0) {
             render(buffer, samplesThisSegment, bufferOffset);
             bufferOffset += samplesThisSegment;
         }
 
-        // Handle the event. Ignore MIDI messages such as sysex.
-        if (metadata.numBytes <= 3) {
-            uint8_t data1 = (metadata.numBytes >= 2) ? metadata.data[1] : 0;
-            uint8_t data2 = (metadata.numBytes == 3) ? metadata.data[2] : 0;
-            handleMIDI(metadata.data[0], data1, data2);
-        }
+        // Handle the event
+        handleMIDI(event.data0, event.data1, event.data2);
     }
 
     // Render the audio after the last MIDI event. If there wre no
@@ -323,27 +496,132 @@ void JX11AudioProcessor::splitBufferByEvents(juce::AudioBuffer<float>& buffer, j
 
 void JX11AudioProcessor::handleMIDI(uint8_t data0, uint8_t data1, uint8_t data2)
 {
+    handleProgramAndVolume(data0, data1, data2);
+
+    // Other commands send to synth object
+    synth.midiMessage(data0, data1, data2);
+}
+
+void JX11AudioProcessor::handleProgramAndVolume(uint8_t data0, uint8_t data1, uint8_t data2)
+{
+    // Telling the host about a parameter isn't realtime safe, so the synth
+    // plays the change right away and the parameters follow later. A change
+    // that doesn't fit in the queue is dropped.
+
     // If command is program change
     if ((data0 & 0xF0) == 0xC0) {
         // And called preset is within bounds
-        if (data1 < presets.size()) {
-            // Change current preset
-            setCurrentProgram(data1);
+        if (data1 < NUM_FACTORY_PRESETS && presetSettings != nullptr
+            && queueMidiChange(MidiChange::PROGRAM, data1)) {
+            playProgram(data1);
         }
     }
 
     // If command is control change
     if ((data0 & 0xF0) == 0xB0) {
-        if (data1 == 0x07) {
-            float volumeCtl = float(data2) / 127.0f;
-            outputLevelParam->beginChangeGesture();
-            outputLevelParam->setValueNotifyingHost(volumeCtl);
-            outputLevelParam->endChangeGesture(); 
+        if (data1 == 0x07 && queueMidiChange(MidiChange::VOLUME, data2)) {
+            float level = outputLevelParam->convertFrom0to1(float(data2) / 127.0f);
+            volumeOverride = juce::Decibels::decibelsToGain(level);
+            synth.outputLevelSmoother.setTargetValue(volumeOverride);
+            if (renderingParts) {
+                multiSynth.setOutputLevel(0, volumeOverride);
+            }
         }
     }
+}
 
-    // Other commands send to synth object
-    synth.midiMessage(data0, data1, data2);
+bool JX11AudioProcessor::queueMidiChange(MidiChange::Type type, uint8_t value)
+{
+    {
+        auto scope = midiFifo.write(1);
+        if (scope.blockSize1 == 0) { return false; }
+        midiChanges[scope.startIndex1] = { type, value };
+    }
+    midiChangesQueued += 1;
+    return true;
+}
+
+void JX11AudioProcessor::applyMidiChanges()
+{
+    // The parameters only reach the value tree later, so mark what they
+    // change here to have it in the next settings
+    ParameterMask changed = 0;
+    uint32_t count = 0;
+    {
+        auto scope = midiFifo.read(midiFifo.getNumReady());
+        scope.forEach([&](int index)
+        {
+            const MidiChange& change = midiChanges[index];
+            if (change.type == MidiChange::PROGRAM) {
+                loadProgramParameters(change.value);
+                changed |= ALL_PARAMETERS;
+            }
+            else {
+                outputLevelParam->beginChangeGesture();
+                outputLevelParam->setValueNotifyingHost(float(change.value) / 127.0f);
+                outputLevelParam->endChangeGesture();
+                changed |= parameterBit(PARAM_OUTPUT_LEVEL);
+            }
+            count += 1;
+        });
+    }
+    if (count == 0) { return; }
+
+    // The audio thread drops its overrides once the settings say they have
+    // all its changes, so publish even if the parameters didn't move
+    const juce::ScopedLock lock(settingsLock);
+    midiChangesApplied += count;
+    dirtyParameters.fetch_or(changed | parameterBit(NUM_PARAMS));
+}
+
+void JX11AudioProcessor::handlePartMIDI(int part, uint8_t data0, uint8_t data1, uint8_t data2)
+{
+    // Program change and volume of the other parts aren't parameters, the
+    // timer picks them up from here
+    PartSettings& settings = partSettings[part];
+    bool changed = false;
+    if ((data0 & 0xF0) == 0xC0 && data1 < NUM_FACTORY_PRESETS) {
+        settings.program.store(data1);
+        settings.outputLevel.store(FACTORY_PRESETS[data1].param[PARAM_OUTPUT_LEVEL]);
+        changed = true;
+    }
+    if ((data0 & 0xF0) == 0xB0 && data1 == 0x07) {
+        settings.outputLevel.store(outputLevelParam->convertFrom0to1(float(data2) / 127.0f));
+        changed = true;
+    }
+    if (changed) {
+        dirtyParts.fetch_or(1u << part);
+    }
+}
+
+void JX11AudioProcessor::renderParts(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    // Every part renders the whole buffer on its own, so the events are
+    // handed over with their positions instead of splitting the buffer
+    int numEvents = collectEvents(midiMessages);
+    for (int i = 0; i < numEvents; ++i) {
+        const MidiEvent& event = blockEvents[size_t(i)];
+        // Only channel messages, system messages have no part
+        if (event.data0 < 0xF0) {
+            int part = event.data0 & 0x0F;
+            if (part == 0) {
+                handleProgramAndVolume(event.data0, event.data1, event.data2);
+            }
+            else {
+                handlePartMIDI(part, event.data0, event.data1, event.data2);
+            }
+            multiSynth.addEvent(event.position, event.data0, event.data1, event.data2);
+        }
+    }
+
+    float* outputBuffers[2] = { nullptr, nullptr };
+    outputBuffers[0] = buffer.getWritePointer(0);
+    if (getTotalNumOutputChannels() > 1) {
+        outputBuffers[1] = buffer.getWritePointer(1);
+    }
+    multiSynth.render(outputBuffers, buffer.getNumSamples(), renderThreads);
+
+    midiMessages.clear();
 }
 
 void JX11AudioProcessor::render(juce::AudioBuffer<float>& buffer, int sampleCount, int bufferOffset)
@@ -365,25 +643,65 @@ bool JX11AudioProcessor::hasEditor() const
 
 juce::AudioProcessorEditor* JX11AudioProcessor::createEditor()
 {
-    auto editor = new juce::GenericAudioProcessorEditor(*this);
-    editor->setSize(500, 1050);
-    return editor;
-    // return new JX11AudioProcessorEditor(*this);
+    return new JX11AudioProcessorEditor(*this);
 }
 
 //==============================================================================
 void JX11AudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    copyXmlToBinary(*apvts.copyState().createXml(), destData);
+    // The binary state in PluginState.h, sessions with many instances
+    // load a lot faster than with the XML of the value tree
+    float values[NUM_STATE_PARAMS];
+    for (int i = 0; i < NUM_STATE_PARAMS; ++i) {
+        values[i] = stateParams[i]->convertFrom0to1(stateParams[i]->getValue());
+    }
+    PartState parts[NUM_STATE_PARTS];
+    for (int i = 0; i < NUM_STATE_PARTS; ++i) {
+        parts[i].program = float(partSettings[i + 1].program.load());
+        parts[i].outputLevel = partSettings[i + 1].outputLevel.load();
+    }
+    destData.setSize(size_t(BINARY_STATE_SIZE));
+    writeBinaryState(values, parts, static_cast<uint8_t*>(destData.getData()));
 }
 
 void JX11AudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
-    if (xml.get() != nullptr && xml->hasTagName(apvts.state.getType())) {
+    // Parameters the state doesn't have go back to their defaults, the
+    // same as with replaceState()
+    float values[NUM_STATE_PARAMS];
+    for (int i = 0; i < NUM_STATE_PARAMS; ++i) {
+        values[i] = stateParams[i]->convertFrom0to1(stateParams[i]->getDefaultValue());
+    }
+
+    // Parts the state doesn't have play the first preset, as in a new
+    // instance
+    PartState parts[NUM_STATE_PARTS];
+    for (PartState& part : parts) {
+        part.program = 0.0f;
+        part.outputLevel = FACTORY_PRESETS[0].param[PARAM_OUTPUT_LEVEL];
+    }
+
+    if (readBinaryState(data, size_t(std::max(sizeInBytes, 0)), values, parts) >= 0) {
+        for (int i = 0; i < NUM_STATE_PARAMS; ++i) {
+            stateParams[i]->setValueNotifyingHost(stateParams[i]->convertTo0to1(values[i]));
+        }
+    }
+    else {
+        // Sessions saved by older versions have XML
+        std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
+        if (xml.get() == nullptr || !xml->hasTagName(apvts.state.getType())) { return; }
         apvts.replaceState(juce::ValueTree::fromXml(*xml));
-        parametersChanged.store(true);
     }
+
+    for (int i = 0; i < NUM_STATE_PARTS; ++i) {
+        int program = int(juce::jlimit(0.0f, float(NUM_FACTORY_PRESETS - 1), parts[i].program));
+        float level = outputLevelParam->getNormalisableRange().snapToLegalValue(parts[i].outputLevel);
+        partSettings[i + 1].program.store(program);
+        partSettings[i + 1].outputLevel.store(level);
+    }
+    dirtyParameters.store(~ParameterMask(0));
+    dirtyParts.store(~uint32_t(0));
+    publishSettings();
 }
 
 //==============================================================================
@@ -397,6 +715,87 @@ juce::AudioProcessorValueTreeState::ParameterLayout JX11AudioProcessor::createPa
         juce::StringArray{ "Mono", "Poly" },
         1));
 
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        ParameterID::voices,
+        "Voices",
+        juce::StringArray{ "8", "16", "32", "64", "128" },
+        0));
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        ParameterID::oscEngine,
+        "Osc Engine",
+        juce::StringArray{ "BLIT", "PolyBLEP" },
+        0));
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        ParameterID::unison,
+        "Unison",
+        juce::StringArray{ "1", "2", "3", "4", "5", "6", "7", "8" },
+        0));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        ParameterID::unisonDetune,
+        "Unison Detune",
+        juce::NormalisableRange<float>(0.0f, 100.0f, 1.0f),
+        20.0f,
+        juce::AudioParameterFloatAttributes().withLabel("%")));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        ParameterID::unisonWidth,
+        "Unison Width",
+        juce::NormalisableRange<float>(0.0f, 100.0f, 1.0f),
+        50.0f,
+        juce::AudioParameterFloatAttributes().withLabel("%")));
+
+    // Not part of the presets, it depends on the machine and not the sound
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        ParameterID::renderThreads,
+        "Render Threads",
+        juce::StringArray{ "1", "2", "3", "4" },
+        0));
+
+    // Not in the presets either, it trades CPU for less aliasing
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        ParameterID::oversampling,
+        "Oversampling",
+        juce::StringArray{ "Off", "2x", "4x" },
+        0));
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        ParameterID::oversamplingQuality,
+        "Oversampling Quality",
+        juce::StringArray{ "Normal", "High" },
+        0));
+
+    // How often the modulation runs, coarser saves CPU. Also not in the
+    // presets, like oversampling.
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        ParameterID::controlRate,
+        "Control Rate",
+        juce::StringArray(CONTROL_RATE_NAMES, NUM_CONTROL_RATES),
+        0));
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        ParameterID::controlInterpolation,
+        "Control Interpolation",
+        juce::StringArray{ "Off", "On" },
+        0));
+
+    // Not in the presets, the parts play presets of their own
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        ParameterID::multiTimbral,
+        "Multi-Timbral",
+        juce::StringArray{ "Off", "On" },
+        0));
+
+    // Not in the presets either. Controller messages only start a new
+    // render segment on this grid, notes keep their exact timing.
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        ParameterID::midiGrid,
+        "MIDI CC Grid",
+        juce::StringArray{ "Off", "8 Samples", "16 Samples", "32 Samples", "64 Samples" },
+        0));
+
     layout.add(std::make_unique<juce::AudioParameterFloat>(
         ParameterID::oscTune,
         "Osc Tune",
@@ -611,127 +1010,228 @@ juce::AudioProcessorValueTreeState::ParameterLayout JX11AudioProcessor::createPa
     return layout;
 }
 
-void JX11AudioProcessor::update()
+void JX11AudioProcessor::valueTreePropertyChanged(juce::ValueTree& tree, const juce::Identifier&)
 {
-    float sampleRate = float(getSampleRate());
-    float inverseSampleRate = 1.0f / sampleRate;
-
-    // Envelope
-    synth.envAttack = std::exp(-inverseSampleRate
-        * std::exp(5.5f - 0.075f *
-            envAttackParam->get()));
-
-    synth.envDecay = std::exp(-inverseSampleRate
-        * std::exp(5.5f - 0.075f *
-            envDecayParam->get()));
-
-    synth.envSustain = envSustainParam->get() * 1e-2f;
-
-    float envRelease = envReleaseParam->get();
-    if (envRelease < 1.0f) {
-        synth.envRelease = 0.75f;
-    }
-    else {
-        synth.envRelease = std::exp(-inverseSampleRate
-            * std::exp(5.5f - 0.075f * envRelease));
+    // Every parameter has its own child tree, named by its "id" property
+    juce::String id = tree.getProperty("id").toString();
+    for (int i = 0; i < NUM_PARAMS; ++i) {
+        if (presetParams[i]->getParameterID() == id) {
+            dirtyParameters.fetch_or(parameterBit(i));
+            triggerAsyncUpdate();
+            return;
+        }
     }
+    // Render Threads and the like, which aren't stored in presets
+    dirtyParameters.fetch_or(parameterBit(NUM_PARAMS));
+    triggerAsyncUpdate();
+}
 
-    // Noise paramChange
-    float noiseMix = noiseParam->get() * 1e-2f;
-    noiseMix *= noiseMix;
-    synth.noiseMix = noiseMix * 0.06f;
-
-    // Filter
-    synth.filterKeyTracking = 0.08f * filterFreqParam->get() - 1.5f;
-    float filterReso = filterResoParam->get() / 100.0f;
-    synth.filterQ = std::exp(3.0f * filterReso);
-
-    float filterLFO = filterLFOParam->get() / 100.0f;
-    synth.filterLFODepth = 2.5f * filterLFO * filterLFO;
+void JX11AudioProcessor::handleAsyncUpdate()
+{
+    applyMidiChanges();
+    applyProgramRequest();
+    publishSettings();
+}
 
-    // Osc Mix
-    synth.oscMix = oscMixParam->get() * 1e-2f;
+void JX11AudioProcessor::timerCallback()
+{
+    // Most of the time there's nothing queued, don't take the lock then
+    bool programRequested = (programRequest.load() >> 8) != programRequestsLoaded;
+    if (programRequested || midiFifo.getNumReady() > 0 || dirtyParts.load() != 0) {
+        applyMidiChanges();
+        applyProgramRequest();
+        publishSettings();
+    }
+    releaseUnusedParts();
+}
 
-    // Adjust voice gain based on mix levels
-    synth.volumeTrim = 0.0008f * (3.2f - synth.oscMix - 25.0f * synth.noiseMix) * (1.5f - 0.5f * filterReso);
+void JX11AudioProcessor::applyProgramRequest()
+{
+    int index = -1;
+    {
+        const juce::ScopedLock lock(settingsLock);
+        uint32_t request = programRequest.load();
+        if ((request >> 8) != programRequestsLoaded) {
+            programRequestsLoaded = request >> 8;
+            index = int(request & 0xFF);
+        }
+    }
+    if (index < 0) { return; }
 
-    // Detune between oscs
-    float semi = oscTuneParam->get();
-    float cent = oscFineParam->get();
-    synth.detune = std::pow(1.059463094359f, -semi - 0.01f * cent); // 2^(-semi - ...)/12
+    // Same as a program change from MIDI, the settings have to include it
+    // even if no parameter moved
+    loadProgramParameters(index);
+    dirtyParameters.fetch_or(ALL_PARAMETERS | parameterBit(NUM_PARAMS));
+}
 
-    // Velocity
-    float filterVelocity = filterVelocityParam->get();
-    if (filterVelocity < -90.0f) {
-        synth.velocitySensitivity = 0.0f;
-        synth.ignoreVelocity = true;
+void JX11AudioProcessor::publishSettings()
+{
+    const juce::ScopedLock lock(settingsLock);
+
+    // Nothing can be worked out before the sample rate is known
+    if (settingsSampleRate <= 0.0f) { return; }
+
+    // Take the changes made so far, later ones trigger another update
+    ParameterMask changed = dirtyParameters.exchange(0);
+    uint32_t changedParts = dirtyParts.exchange(0);
+    if (changed == 0 && changedParts == 0) { return; }
+
+    float param[NUM_PARAMS];
+    param[PARAM_OSC_MIX] = oscMixParam->get();
+    param[PARAM_OSC_TUNE] = oscTuneParam->get();
+    param[PARAM_OSC_FINE] = oscFineParam->get();
+    param[PARAM_GLIDE_MODE] = float(glideModeParam->getIndex());
+    param[PARAM_GLIDE_RATE] = glideRateParam->get();
+    param[PARAM_GLIDE_BEND] = glideBendParam->get();
+    param[PARAM_FILTER_FREQ] = filterFreqParam->get();
+    param[PARAM_FILTER_RESO] = filterResoParam->get();
+    param[PARAM_FILTER_ENV] = filterEnvParam->get();
+    param[PARAM_FILTER_LFO] = filterLFOParam->get();
+    param[PARAM_FILTER_VELOCITY] = filterVelocityParam->get();
+    param[PARAM_FILTER_ATTACK] = filterAttackParam->get();
+    param[PARAM_FILTER_DECAY] = filterDecayParam->get();
+    param[PARAM_FILTER_SUSTAIN] = filterSustainParam->get();
+    param[PARAM_FILTER_RELEASE] = filterReleaseParam->get();
+    param[PARAM_ENV_ATTACK] = envAttackParam->get();
+    param[PARAM_ENV_DECAY] = envDecayParam->get();
+    param[PARAM_ENV_SUSTAIN] = envSustainParam->get();
+    param[PARAM_ENV_RELEASE] = envReleaseParam->get();
+    param[PARAM_LFO_RATE] = lfoRateParam->get();
+    param[PARAM_VIBRATO] = vibratoParam->get();
+    param[PARAM_NOISE] = noiseParam->get();
+    param[PARAM_OCTAVE] = octaveParam->get();
+    param[PARAM_TUNING] = tuningParam->get();
+    param[PARAM_OUTPUT_LEVEL] = outputLevelParam->get();
+    param[PARAM_POLY_MODE] = float(polyModeParam->getIndex());
+    param[PARAM_VOICES] = float(voicesParam->getIndex());
+    param[PARAM_OSC_ENGINE] = float(oscEngineParam->getIndex());
+    param[PARAM_UNISON] = float(unisonParam->getIndex());
+    param[PARAM_UNISON_DETUNE] = unisonDetuneParam->get();
+    param[PARAM_UNISON_WIDTH] = unisonWidthParam->get();
+
+    // The voices run at the oversampled rate, when it or the control rate
+    // changes everything that depends on the rate has to be worked out again
+    int oversampling = 1 << oversamplingParam->getIndex();
+    int oversamplingQuality = oversamplingQualityParam->getIndex();
+    float voiceRate = settingsSampleRate * float(oversampling);
+    int controlInterval = controlIntervalFor(controlRateParam->getIndex(), voiceRate);
+    bool interpolateFilter = controlInterpolationParam->getIndex() == 1;
+    if (oversampling != latestSettings.oversampling || controlInterval != latestSettings.controlInterval) {
+        changed |= ALL_PARAMETERS;
+        changedParts = ~uint32_t(0);
+    }
+    if (interpolateFilter != latestSettings.interpolateFilter) {
+        changedParts = ~uint32_t(0);
+    }
+    float latency = Oversampler::getLatency(oversampling, oversamplingQuality);
+    setLatencySamples(juce::roundToInt(latency));
+
+    // Helpers only for the engine in use and only as many as asked for,
+    // a session can have hundreds of instances. They're running before
+    // the settings that use them go out.
+    int numThreads = renderThreadsParam->getIndex() + 1;
+    bool partsWanted = multiTimbralParam->getIndex() == 1;
+    if (partsWanted) {
+        updatePartResources(true);
+        multiSynth.startRenderThreads(numThreads);
     }
     else {
-        synth.velocitySensitivity = 0.0005f * filterVelocity;
-        synth.ignoreVelocity = false;
+        synth.startRenderThreads(numThreads);
     }
 
-    // Output Level
-    synth.outputLevelSmoother.setTargetValue(
-        juce::Decibels::decibelsToGain(outputLevelParam->get()));
-
-    // Global tuning
-    float octave = octaveParam->get();
-    float tuning = tuningParam->get();
-
-    // Optimized freq calc
-    float tuneInSemi = -36.3763f - 12.0f * octave - tuning * 1e-2f;
-
-    // synth.tune = octave * 12.0f + tuning * 1e-2f;
-    synth.tune = sampleRate * std::exp(0.05776226505f *
-        tuneInSemi);
-
-    // Polyphony
-    synth.numVoices = (polyModeParam->getIndex() == 0) ? 1 : Synth::MAX_VOICES;
-
-    // Modulation
-    const float inverseUpdateRate = inverseSampleRate * synth.LFO_MAX;
-
-    // Filter Env
-    synth.filterAttack = std::exp(-inverseUpdateRate *
-        std::exp(5.5f - 0.075f * filterAttackParam->get()));
-
-    synth.filterDecay = std::exp(-inverseUpdateRate *
-        std::exp(5.5f - 0.075f * filterDecayParam->get()));
-
-    float filterSustain = filterSustainParam->get() / 100.0f;
-    synth.filterSustain = filterSustain * filterSustain;
-
-    synth.filterRelease = std::exp(-inverseUpdateRate *
-        std::exp(5.5f - 0.075f * filterReleaseParam->get()));
-
-    synth.filterEnvDepth = 0.06f * filterEnvParam->get();
-
-    // LFO Phasor
-    float lfoRate = std::exp(7.0f * lfoRateParam->get() - 4.0f);
-    synth.lfoInc = lfoRate * inverseUpdateRate * float(TWO_PI);
-    float vibrato = vibratoParam->get() / 200.0f;
-    synth.vibrato = 0.2f * vibrato * vibrato;
-
-    // PWM Depth
-    synth.pwmDepth = synth.vibrato;
-    if (vibrato < 0.0f) { synth.vibrato = 0.0f; }
+    // The preset table shares everything but the preset parameters, so
+    // only these make it out of date. A program change doesn't.
+    bool presetsChanged = voiceRate != presetSettingsRate
+        || oversampling != latestSettings.oversampling
+        || oversamplingQuality != latestSettings.oversamplingQuality
+        || controlInterval != latestSettings.controlInterval
+        || interpolateFilter != latestSettings.interpolateFilter
+        || numThreads != latestSettings.renderThreads;
+
+    if (changed != 0) {
+        latestSettings.oversampling = oversampling;
+        latestSettings.oversamplingQuality = oversamplingQuality;
+        latestSettings.controlInterval = controlInterval;
+        latestSettings.interpolateFilter = interpolateFilter;
+
+        // The mapping is shared with the offline renderer. Only the values that
+        // depend on a changed parameter are worked out again.
+        applyParameters(latestSettings, param, voiceRate, changed);
+        latestSettings.renderThreads = numThreads;
+        latestSettings.midiChanges = midiChangesApplied;
+        latestSettings.programRequests = programRequestsLoaded;
+
+        if (presetsChanged) {
+            publishPresetSettings(voiceRate);
+        }
 
-    // Glide
-    synth.glideMode = glideModeParam->getIndex();
+        // The audio thread picks this up at the start of its next block
+        settingsBuffer.back() = latestSettings;
+        settingsBuffer.publish();
+    }
+    if (!partsWanted) {
+        updatePartResources(false);
+    }
+    int grid = midiGridParam->getIndex();
+    midiGrid.store(grid == 0 ? 1 : 4 << grid);
+
+    // The other parts play presets, only the program and level differ. A
+    // new preset changes everything, so these are always done in full.
+    for (int part = 1; part < NUM_PARTS; ++part) {
+        PartSettings& settings = partSettings[part];
+        if ((changedParts & (1u << part)) == 0) { continue; }
+
+        const Preset& preset = FACTORY_PRESETS[settings.program.load()];
+        float partParam[NUM_PARAMS];
+        std::copy(preset.param, preset.param + NUM_PARAMS, partParam);
+        partParam[PARAM_OUTPUT_LEVEL] = settings.outputLevel.load();
+
+        settings.latestSettings.oversampling = oversampling;
+        settings.latestSettings.oversamplingQuality = oversamplingQuality;
+        settings.latestSettings.controlInterval = controlInterval;
+        settings.latestSettings.interpolateFilter = interpolateFilter;
+        applyParameters(settings.latestSettings, partParam, voiceRate);
+        settings.latestSettings.renderThreads = 1;
+
+        settings.settingsBuffer.back() = settings.latestSettings;
+        settings.settingsBuffer.publish();
+    }
 
-    float glideRate = glideRateParam->get();
-    if (glideRate < 2.0f) {
-        synth.glideRate = 1.0f; // no glide
+    // Lets the host stop calling processBlock once the release has run out
+    float releaseSeconds = latestSettings.releaseSeconds;
+    if (multiTimbral.load()) {
+        for (int part = 1; part < NUM_PARTS; ++part) {
+            releaseSeconds = std::max(releaseSeconds, partSettings[part].latestSettings.releaseSeconds);
+        }
     }
-    else {
-        synth.glideRate = 1.0f - std::exp(-inverseUpdateRate *
-            std::exp(6.0f - 0.07f * glideRate)
-        );
+    tailLength.store(double(releaseSeconds + latency / settingsSampleRate));
+}
+void JX11AudioProcessor::publishPresetSettings(float voiceRate)
+{
+    // Every preset in full, this only happens when the rate or the
+    // settings outside the presets change
+    presetSettingsRate = voiceRate;
+    std::vector<SynthSettings>& table = presetSettingsBuffer.back();
+    table.resize(NUM_FACTORY_PRESETS);
+    for (size_t i = 0; i < table.size(); ++i) {
+        SynthSettings& settings = table[i];
+        settings.oversampling = latestSettings.oversampling;
+        settings.oversamplingQuality = latestSettings.oversamplingQuality;
+        settings.controlInterval = latestSettings.controlInterval;
+        settings.interpolateFilter = latestSettings.interpolateFilter;
+        applyParameters(settings, FACTORY_PRESETS[i].param, voiceRate);
+        settings.renderThreads = latestSettings.renderThreads;
     }
+    presetSettingsBuffer.publish();
+}
 
-    synth.glideBend = glideBendParam->get();
+void JX11AudioProcessor::getSafetyCounts(uint32_t& silenced, uint32_t& clamped) const
+{
+    multiSynth.getSafetyCounts(silenced, clamped);
+    silenced += synth.getSafetyCounters().silenced.load(std::memory_order_relaxed);
+    clamped += synth.getSafetyCounters().clamped.load(std::memory_order_relaxed);
 }
+
 //==============================================================================
 // This creates new instances of the plugin..
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
@@ -10,7 +10,13 @@
 
 #include <JuceHeader.h>
 #include "Synth.h"
+#include "MultiTimbralSynth.h"
 #include "Preset.h"
+#include "SynthParameters.h"
+#include "SnapshotBuffer.h"
+#include "LoadMeter.h"
+#include "PluginState.h"
+#include "EventCoalescer.h"
 
 namespace ParameterID
 {
@@ -42,6 +48,18 @@ namespace ParameterID
         PARAMETER_ID(tuning)
         PARAMETER_ID(outputLevel)
         PARAMETER_ID(polyMode)
+        PARAMETER_ID(voices)
+        PARAMETER_ID(oscEngine)
+        PARAMETER_ID(unison)
+        PARAMETER_ID(unisonDetune)
+        PARAMETER_ID(unisonWidth)
+        PARAMETER_ID(renderThreads)
+        PARAMETER_ID(oversampling)
+        PARAMETER_ID(oversamplingQuality)
+        PARAMETER_ID(controlRate)
+        PARAMETER_ID(controlInterpolation)
+        PARAMETER_ID(multiTimbral)
+        PARAMETER_ID(midiGrid)
 
 #undef PARAMETER_ID
 }
@@ -50,7 +68,9 @@ namespace ParameterID
 /**
 */
 class JX11AudioProcessor  : public juce::AudioProcessor,
-    private juce::ValueTree::Listener
+    private juce::ValueTree::Listener,
+    private juce::AsyncUpdater,
+    private juce::Timer
 {
 public:
     //==============================================================================
@@ -91,22 +111,143 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    // Buffers the output safety stage had to mute or clip so far, in the
+    // synth and in all parts. Safe to call from any thread.
+    void getSafetyCounts(uint32_t& silenced, uint32_t& clamped) const;
+
+    // Time spent in processBlock, read by the editor. Only one thread may
+    // call update() on it.
+    LoadMeter& getLoadMeter() { return loadMeter; }
+
     juce::AudioProcessorValueTreeState apvts{ *this, nullptr, "Parameters", createParameterLayout() };
 
 private:
 
-    void valueTreePropertyChanged(juce::ValueTree&, const juce::Identifier&) override
+    void valueTreePropertyChanged(juce::ValueTree& tree, const juce::Identifier&) override;
+
+    void handleAsyncUpdate() override;
+
+    // Picks up what the audio thread queued. Posting a message may block,
+    // so the audio thread never triggers an update itself.
+    static constexpr int MIDI_POLL_HZ = 30;
+    void timerCallback() override;
+
+    // Works out the settings for the dirty parameters and hands them to the
+    // audio thread. Never called on the audio thread.
+    void publishSettings();
+
+    // One bit per changed parameter, in ParameterIndex order. The bit after
+    // the preset parameters stands for the ones that aren't in presets.
+    std::atomic<ParameterMask> dirtyParameters { 0 };
+
+    // Settings as of the last publishSettings(), and the sample rate they're
+    // for. Only touched with settingsLock held, which the audio thread never
+    // takes.
+    juce::CriticalSection settingsLock;
+    SynthSettings latestSettings;
+    float settingsSampleRate = 0.0f;
+
+    SnapshotBuffer<SynthSettings> settingsBuffer;
+
+    // The settings of every factory preset, for the current rate and the
+    // parameters that aren't in presets. A program change from MIDI plays
+    // one of these right away, before the parameters catch up.
+    SnapshotBuffer<std::vector<SynthSettings>> presetSettingsBuffer;
+    float presetSettingsRate = 0.0f; // voice rate of the table, with settingsLock held
+    void publishPresetSettings(float voiceRate);
+
+    // Program changes and CC 7 for the patch being edited. The audio thread
+    // applies them and queues them here; the timer writes them to the
+    // parameters on the message thread, where the host hears about them.
+    struct MidiChange
     {
-        parametersChanged.store(true);
-    }
+        enum Type : uint8_t { PROGRAM, VOLUME };
+        Type type;
+        uint8_t value;
+    };
+    static constexpr int MIDI_FIFO_SIZE = 256;
+    juce::AbstractFifo midiFifo { MIDI_FIFO_SIZE };
+    MidiChange midiChanges[MIDI_FIFO_SIZE];
+    uint32_t midiChangesApplied = 0; // only with settingsLock held
+    bool queueMidiChange(MidiChange::Type type, uint8_t value);
+    void applyMidiChanges();
 
-    void update(); // Calculations to update parameters
+    // Program changes from the host go the other way: the audio thread
+    // picks up the newest one at its next block, the timer loads the
+    // parameters. The request holds a count in the upper 24 bits and the
+    // program in the lower 8.
+    std::atomic<uint32_t> programRequest { 0 };
+    static_assert(NUM_FACTORY_PRESETS <= 256, "programs have to fit in 8 bits");
+    uint32_t programRequestsLoaded = 0; // count, message thread, written with settingsLock held
+    void applyProgramRequest();
 
-    std::atomic<bool> parametersChanged { false };
+    // For getTailLengthSeconds(), worked out with the settings
+    std::atomic<double> tailLength { 0.0 };
+
+    // Multi-timbral mode: every MIDI channel plays a part of its own.
+    // Channel 1 plays the patch being edited, the other channels a factory
+    // preset picked with program change, at a level set with CC 7.
+    static constexpr int NUM_PARTS = MultiTimbralSynth::NUM_PARTS;
+    struct PartSettings
+    {
+        std::atomic<int> program { 0 };
+        std::atomic<float> outputLevel { 0.0f }; // dB
+
+        SynthSettings latestSettings; // only with settingsLock held
+        SnapshotBuffer<SynthSettings> settingsBuffer;
+    };
+    PartSettings partSettings[NUM_PARTS]; // the first part uses the settings above
+    static_assert(NUM_PARTS - 1 == NUM_STATE_PARTS, "the state has the parts after the first");
+    std::atomic<uint32_t> dirtyParts { 0 }; // one bit per part
+
+    // The parts only have their voices and buffers while the mode is on.
+    // The message thread allocates them before it sets multiTimbral, and
+    // frees them once multiTimbral is off and partsInUse says the audio
+    // thread has let go. The audio thread sets partsInUse before it looks
+    // at multiTimbral, so one of the two always sees the other.
+    std::atomic<bool> multiTimbral { false };
+    std::atomic<bool> partsInUse { false };
+    std::atomic<bool> partsAllocated { false }; // written with settingsLock held
+    int settingsBlockSize = 0; // only with settingsLock held, 0 when released
+    void updatePartResources(bool wanted);
+    void releaseUnusedParts();
+
+    // Audio thread only. The parts get the settings only while they're
+    // rendered, the newest ones are kept for when they start.
+    bool renderingParts = false;
+    int renderThreads = 1;
+    const SynthSettings* currentSettings = nullptr;
+    const SynthSettings* currentPartSettings[NUM_PARTS] = {};
+    void takeSettings();
+    void useSettings(const SynthSettings* settings);
+    void playProgram(int index);
+    void startParts();
+
+    // Also audio thread only. Until the settings include every MIDI change
+    // queued so far, the synth keeps playing the preset and level they set.
+    const std::vector<SynthSettings>* presetSettings = nullptr;
+    uint32_t midiChangesQueued = 0;
+    uint32_t programRequestsTaken = 0;
+    int programOverride = -1;
+    float volumeOverride = -1.0f; // gain
+
+    // Resets the synth that plays the edited patch, alone or as the first part
+    void resetSynth();
+
+    // Preset parameters in ParameterIndex order
+    juce::RangedAudioParameter* presetParams[NUM_PARAMS];
+
+    // Every parameter, in the order of the saved state
+    juce::RangedAudioParameter* stateParams[NUM_STATE_PARAMS];
+
+    // Writes a preset into the parameters, without resetting the synth
+    void loadProgramParameters(int index);
 
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
     Synth synth;
+    MultiTimbralSynth multiSynth;
+    LoadMeter loadMeter;
 
     juce::AudioParameterFloat* oscMixParam;
     juce::AudioParameterFloat* oscTuneParam;
@@ -134,14 +275,35 @@ private:
     juce::AudioParameterFloat* tuningParam;
     juce::AudioParameterFloat* outputLevelParam;
     juce::AudioParameterChoice* polyModeParam;
+    juce::AudioParameterChoice* voicesParam;
+    juce::AudioParameterChoice* oscEngineParam;
+    juce::AudioParameterChoice* unisonParam;
+    juce::AudioParameterFloat* unisonDetuneParam;
+    juce::AudioParameterFloat* unisonWidthParam;
+    juce::AudioParameterChoice* renderThreadsParam;
+    juce::AudioParameterChoice* oversamplingParam;
+    juce::AudioParameterChoice* oversamplingQualityParam;
+    juce::AudioParameterChoice* controlRateParam;
+    juce::AudioParameterChoice* controlInterpolationParam;
+    juce::AudioParameterChoice* multiTimbralParam;
+    juce::AudioParameterChoice* midiGridParam;
+
+    // The MIDI of the block, thinned out by the coalescer as it comes in.
+    // Past MAX_BLOCK_EVENTS controller messages make room for the rest.
+    // Audio thread only.
+    static constexpr int MAX_BLOCK_EVENTS = 4096;
+    std::vector<MidiEvent> blockEvents;
+    EventCoalescer coalescer;
+    std::atomic<int> midiGrid { 1 }; // samples, 1 = off
+    int collectEvents(const juce::MidiBuffer& midiMessages);
 
     void splitBufferByEvents(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages);
     void handleMIDI(uint8_t data0, uint8_t data1, uint8_t data2);
+    void handleProgramAndVolume(uint8_t data0, uint8_t data1, uint8_t data2);
+    void handlePartMIDI(int part, uint8_t data0, uint8_t data1, uint8_t data2);
+    void renderParts(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages);
     void render(juce::AudioBuffer<float>& buffer, int sampleCount, int bufferOffset);
-    // Create presets
-    void createPrograms();
-    std::vector<Preset> presets;
-    int currentProgram;
+    std::atomic<int> currentProgram { 0 };
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (JX11AudioProcessor)
 };
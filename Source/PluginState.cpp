@@ -0,0 +1,109 @@
+/*
+  ==============================================================================
+
+    PluginState.cpp
+    Created: 20 Oct 2026 9:12:44am
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#include "PluginState.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Same IDs as ParameterID in PluginProcessor.h
+const char* const STATE_PARAMETER_IDS[NUM_STATE_PARAMS] = {
+    "oscMix", "oscTune", "oscFine", "glideMode", "glideRate", "glideBend",
+    "filterFreq", "filterReso", "filterEnv", "filterLFO", "filterVelocity",
+    "filterAttack", "filterDecay", "filterSustain", "filterRelease",
+    "envAttack", "envDecay", "envSustain", "envRelease",
+    "lfoRate", "vibrato", "noise", "octave", "tuning", "outputLevel", "polyMode",
+    "voices", "oscEngine", "unison", "unisonDetune", "unisonWidth",
+    "renderThreads", "oversampling", "oversamplingQuality", "controlRate",
+    "controlInterpolation", "multiTimbral", "midiGrid",
+};
+
+static void writeLittleEndian(uint32_t value, int numBytes, uint8_t* data)
+{
+    for (int i = 0; i < numBytes; ++i) {
+        data[i] = uint8_t(value >> (8 * i));
+    }
+}
+
+static uint32_t readLittleEndian(const uint8_t* data, int numBytes)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < numBytes; ++i) {
+        value |= uint32_t(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+static void writeFloat(float value, uint8_t* data)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, 4);
+    writeLittleEndian(bits, 4, data);
+}
+
+// Leaves value alone if the float in data isn't finite
+static void readFloat(const uint8_t* data, float& value)
+{
+    uint32_t bits = readLittleEndian(data, 4);
+    float read;
+    std::memcpy(&read, &bits, 4);
+    if (std::isfinite(read)) { value = read; }
+}
+
+void writeBinaryState(const float* values, const PartState* parts, uint8_t* data)
+{
+    writeLittleEndian(STATE_MAGIC, 4, data);
+    writeLittleEndian(STATE_VERSION, 2, data + 4);
+    writeLittleEndian(NUM_STATE_PARAMS, 2, data + 6);
+    uint8_t* write = data + STATE_HEADER_SIZE;
+    for (int i = 0; i < NUM_STATE_PARAMS; ++i) {
+        writeFloat(values[i], write);
+        write += 4;
+    }
+
+    writeLittleEndian(NUM_STATE_PARTS, 4, write);
+    write += 4;
+    for (int i = 0; i < NUM_STATE_PARTS; ++i) {
+        writeFloat(parts[i].program, write);
+        writeFloat(parts[i].outputLevel, write + 4);
+        write += 8;
+    }
+}
+
+int readBinaryState(const void* data, size_t size, float* values, PartState* parts)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    if (bytes == nullptr || size < size_t(STATE_HEADER_SIZE)
+        || readLittleEndian(bytes, 4) != STATE_MAGIC) {
+        return -1;
+    }
+
+    // A newer state may have more values, those are for parameters this
+    // version doesn't know
+    int version = int(readLittleEndian(bytes + 4, 2));
+    int count = int(readLittleEndian(bytes + 6, 2));
+    size_t valuesEnd = size_t(STATE_HEADER_SIZE + 4 * count);
+    if (size < valuesEnd) { return -1; }
+    for (int i = 0; i < count && i < NUM_STATE_PARAMS; ++i) {
+        readFloat(bytes + STATE_HEADER_SIZE + 4 * i, values[i]);
+    }
+
+    // Same for the parts, a state cut short keeps the ones it has
+    if (parts != nullptr && version >= 2 && size >= valuesEnd + 4) {
+        size_t numParts = readLittleEndian(bytes + valuesEnd, 4);
+        numParts = std::min({ numParts, size_t(NUM_STATE_PARTS), (size - valuesEnd - 4) / 8 });
+        for (size_t i = 0; i < numParts; ++i) {
+            const uint8_t* part = bytes + valuesEnd + 4 + 8 * i;
+            readFloat(part, parts[i].program);
+            readFloat(part + 4, parts[i].outputLevel);
+        }
+    }
+    return count;
+}
@@ -0,0 +1,59 @@
+/*
+  ==============================================================================
+
+    PluginState.h
+    Created: 20 Oct 2026 9:12:44am
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Preset.h"
+
+// The plug-in state as the host saves it in a session. It's a fixed table
+// of values, so loading it parses nothing:
+//
+//   uint32  STATE_MAGIC
+//   uint16  STATE_VERSION
+//   uint16  number of values
+//   float   one value per parameter, in STATE_PARAMETER_IDS order
+//
+// Since version 2, the multi-timbral parts on channels 2 to 16 follow:
+//
+//   uint32  number of parts
+//   float   program, then output level in dB, per part
+//
+// All little endian. Values are in the parameter's own units, the index
+// for a choice. The order never changes: new parameters go at the end and
+// a state with fewer values leaves the others alone. Later versions may
+// only add fields after the values.
+const uint32_t STATE_MAGIC = 0x3131584A; // "JX11"
+const uint16_t STATE_VERSION = 2;
+
+// The preset parameters in ParameterIndex order, then the others
+const int NUM_STATE_PARAMS = NUM_PARAMS + 7;
+extern const char* const STATE_PARAMETER_IDS[NUM_STATE_PARAMS];
+
+// The parts after the first, which plays the parameters
+const int NUM_STATE_PARTS = 15;
+struct PartState
+{
+    float program;
+    float outputLevel; // dB
+};
+
+const int STATE_HEADER_SIZE = 8;
+const int BINARY_STATE_SIZE = STATE_HEADER_SIZE + 4 * NUM_STATE_PARAMS + 4 + 8 * NUM_STATE_PARTS;
+
+// Fills in BINARY_STATE_SIZE bytes
+void writeBinaryState(const float* values, const PartState* parts, uint8_t* data);
+
+// Reads the values of a binary state into values, skipping any that aren't
+// finite. Returns how many there were, or -1 if the data isn't a binary
+// state, like the XML that older versions saved. The parts are read the
+// same way when parts isn't null, a version 1 state leaves them alone.
+int readBinaryState(const void* data, size_t size, float* values, PartState* parts = nullptr);
@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    PolyBlep.h
+    Created: 17 Oct 2026 5:36:14pm
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "Oscillator.h"
+
+// A bank of PolyBLEP sawtooth oscillators, one per lane. It's a cheaper
+// alternative to the BLIT: no division or sin/cos per period, and the saw
+// comes out directly instead of through a leaky integrator. Pitch, level
+// and modulation are read from an OscillatorBank, so the synth drives both
+// engines the same way.
+class PolyBlepBank
+{
+public:
+    PolyBlepBank()
+    {
+        for (int i = 0; i < LANES; ++i) {
+            reset(i);
+        }
+    }
+
+    void reset(int lane)
+    {
+        phase[lane] = 0.0f;
+    }
+
+    // Start half a period away from the other oscillator, for PWM
+    void squareWave(int lane, const PolyBlepBank& other)
+    {
+        float p = other.phase[lane] + 0.5f;
+        phase[lane] = (p >= 1.0f) ? p - 1.0f : p;
+    }
+
+    // Advance every active lane by one sample. Inactive lanes keep their
+    // state and output silence.
+    void nextSample(const LaneMask* active, const OscillatorBank& settings, float* output)
+    {
+        float result[LANES];
+        for (int i = 0; i < LANES; ++i) {
+            // modulation scales the period, like in the BLIT
+            float length = settings.period[i] * settings.modulation[i];
+            float inc = 1.0f / length;
+
+            float t = phase[i] + inc;
+            t = laneSelect(laneMask(t >= 1.0f), t - 1.0f, t);
+
+            // Polynomial band-limited step, smooths the jump at t = 0
+            float x1 = t * length;
+            float x2 = (t - 1.0f) * length;
+            float blep = laneSelect(laneMask(t < inc), x1 + x1 - x1 * x1 - 1.0f, 0.0f);
+            blep = laneSelect(laneMask(t > 1.0f - inc), x2 * x2 + x2 + x2 + 1.0f, blep);
+
+            // Falling saw, same direction and level as the integrated BLIT
+            float saw = 1.0f - t - t + blep;
+
+            phase[i] = laneSelect(active[i], t, phase[i]);
+            result[i] = laneSelect(active[i], settings.amplitude[i] * SAW_LEVEL * saw, 0.0f);
+        }
+        std::memcpy(output, result, sizeof(result));
+    }
+
+private:
+    // Peak level of the integrated BLIT saw for an amplitude of 1
+    const float SAW_LEVEL = 0.5f;
+
+    float phase[LANES];
+};
@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    RenderThreadPool.cpp
+    Created: 17 Oct 2026 2:41:08pm
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#include "RenderThreadPool.h"
+#include <algorithm>
+#include <thread>
+
+// How long an idle helper polls for the next job before it goes to sleep
+static const int SPIN_COUNT = 20000;
+
+RenderThreadPool::~RenderThreadPool()
+{
+    stop();
+}
+
+void RenderThreadPool::start(int newNumHelpers)
+{
+    newNumHelpers = std::min(newNumHelpers, MAX_HELPERS);
+    for (int i = getNumHelpers(); i < newNumHelpers; ++i) {
+        helpers[i] = std::make_unique<Helper>(*this, i + 1);
+        helpers[i]->startRealtimeThread(juce::Thread::RealtimeOptions{});
+        numHelpers.store(i + 1, std::memory_order_release);
+    }
+}
+
+void RenderThreadPool::stop()
+{
+    int count = getNumHelpers();
+    numHelpers.store(0);
+    for (int i = 0; i < count; ++i) {
+        helpers[i]->signalThreadShouldExit();
+        helpers[i]->wakeUp.signal();
+    }
+    for (int i = 0; i < count; ++i) {
+        helpers[i]->stopThread(1000);
+        helpers[i].reset();
+    }
+}
+
+void RenderThreadPool::run(int numJobs, Job job, void* context)
+{
+    jassert(numJobs <= getNumHelpers() + 1 && numJobs <= 0xFF);
+
+    currentJob = job;
+    currentContext = context;
+    pending.store(numJobs - 1);
+
+    // Publish the job, then wake the helpers that already went to sleep.
+    // Only this thread writes work, the helpers just read it.
+    uint64_t next = generationOf(work.load(std::memory_order_relaxed)) + 1;
+    work.store((next << 8) | uint64_t(numJobs), std::memory_order_release);
+    for (int i = 0; i < numJobs - 1; ++i) {
+        if (helpers[i]->sleeping.load()) {
+            helpers[i]->wakeUp.signal();
+        }
+    }
+
+    job(context, 0);
+
+    // The helpers are busy with the same block, so waiting is short
+    while (pending.load(std::memory_order_acquire) > 0) {
+        std::this_thread::yield();
+    }
+}
+
+RenderThreadPool::Helper::Helper(RenderThreadPool& pool_, int index_)
+    : juce::Thread("JX11 voices " + juce::String(index_)), pool(pool_), index(index_),
+      seen(generationOf(pool_.work.load()))
+{
+}
+
+void RenderThreadPool::Helper::run()
+{
+    // Same floating point mode as the audio thread
+    juce::ScopedNoDenormals noDenormals;
+
+    while (!threadShouldExit()) {
+        // Poll for a while, the next block is usually not far away
+        int spin = 0;
+        uint64_t w = pool.work.load(std::memory_order_acquire);
+        while (generationOf(w) == seen && ++spin < SPIN_COUNT) {
+            std::this_thread::yield();
+            w = pool.work.load(std::memory_order_acquire);
+        }
+
+        if (generationOf(w) == seen) {
+            // Check again after announcing that we sleep, so a job published
+            // in between isn't missed
+            sleeping.store(true);
+            if (generationOf(pool.work.load()) == seen && !threadShouldExit()) {
+                wakeUp.wait(-1);
+            }
+            sleeping.store(false);
+            continue;
+        }
+
+        // The job count comes with the generation it belongs to. A helper
+        // that missed runs only sees the newest, which can't be replaced
+        // before every helper it needs is done with it.
+        seen = generationOf(w);
+        if (index < jobsOf(w)) {
+            pool.currentJob(pool.currentContext, index);
+            pool.pending.fetch_sub(1, std::memory_order_release);
+        }
+    }
+}
@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    RenderThreadPool.h
+    Created: 17 Oct 2026 2:41:08pm
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+
+// Realtime helper threads that take part of the audio thread's work.
+// Jobs are handed over through atomics, so run() neither locks nor allocates
+// while the helpers are awake. Idle helpers go to sleep after a short spin.
+class RenderThreadPool
+{
+public:
+    // Called with the number of the job, 0 is always run by the caller
+    using Job = void (*)(void* context, int job);
+
+    static constexpr int MAX_HELPERS = 15;
+
+    ~RenderThreadPool();
+
+    // Starts helpers until there are numHelpers, it never stops any. Not
+    // realtime safe, but another thread may call run() meanwhile: the new
+    // helpers take jobs from the next run() on.
+    void start(int numHelpers);
+
+    // Stops every helper. Only while nothing calls run(), like in
+    // prepareToPlay or releaseResources.
+    void stop();
+
+    int getNumHelpers() const { return numHelpers.load(std::memory_order_acquire); }
+
+    // Run jobs 0 to numJobs - 1 and return when all of them are done.
+    // numJobs must not be larger than getNumHelpers() + 1.
+    void run(int numJobs, Job job, void* context);
+
+private:
+    class Helper : public juce::Thread
+    {
+    public:
+        // Takes the current generation, so it's only given the runs
+        // published after it was counted in
+        Helper(RenderThreadPool& pool, int index);
+        void run() override;
+
+        juce::WaitableEvent wakeUp;
+        std::atomic<bool> sleeping{ false };
+
+    private:
+        RenderThreadPool& pool;
+        int index;
+        uint64_t seen;
+    };
+
+    // A helper is counted once it's running, run() only uses counted ones
+    std::unique_ptr<Helper> helpers[MAX_HELPERS];
+    std::atomic<int> numHelpers{ 0 };
+
+    // The generation in the upper bits, bumped for every call to run(), and
+    // the number of jobs in the lower 8. Helpers wait for the generation to
+    // change and read both in one load, so a helper can never pair a new
+    // generation with an old job count or the other way round.
+    std::atomic<uint64_t> work{ 0 };
+    static uint64_t generationOf(uint64_t w) { return w >> 8; }
+    static int jobsOf(uint64_t w) { return int(w & 0xFF); }
+
+    std::atomic<int> pending{ 0 };
+
+    Job currentJob = nullptr;
+    void* currentContext = nullptr;
+};
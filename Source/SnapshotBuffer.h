@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    SnapshotBuffer.h
+    Created: 17 Oct 2026 7:12:38pm
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+
+// Hands finished snapshots from one writer thread to one reader thread
+// without locks. There are three slots: the writer fills the back slot, the
+// reader uses the front slot, and publishing or acquiring swaps a slot with
+// the one in the middle in a single atomic exchange. Neither side ever
+// waits, and the slot the reader holds is never written to.
+template <typename T>
+class SnapshotBuffer
+{
+public:
+    // Writer: the slot to fill in before calling publish()
+    T& back() { return slots[backIndex]; }
+
+    // Writer: make the back slot the newest snapshot
+    void publish()
+    {
+        backIndex = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Reader: takes the newest snapshot if one was published since the last
+    // call, otherwise returns nullptr. The snapshot stays valid until the
+    // next call that returns a new one.
+    const T* acquire()
+    {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+            return nullptr;
+        }
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+        return &slots[frontIndex];
+    }
+
+private:
+    // middle holds a slot index, plus FRESH if the reader hasn't seen it
+    static constexpr int INDEX = 3;
+    static constexpr int FRESH = 4;
+
+    T slots[3];
+    std::atomic<int> middle { 1 };
+    int backIndex = 0; // only used by the writer
+    int frontIndex = 2; // only used by the reader
+};
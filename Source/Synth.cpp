@@ -9,44 +9,134 @@
 */
 
 #include "Synth.h"
-#include "Utils.h"
+#include "FastMath.h"
 
 // Detuning factor between voices
 static const float ANALOG = 0.002f;
+static const int ANALOG_VOICES = 8; // voices before the detuning repeats
 static const int SUSTAIN = -1;
 
+// Time in seconds for the smoothed parameters to reach a new value
+static const double SMOOTHING_TIME = 0.05;
+
+// Used until the first call to setSettings() and after deallocateResources()
+static const SynthSettings DEFAULT_SETTINGS;
+
 Synth::Synth()
 {
     sampleRate = 44100.0f;
+    voiceRate = sampleRate;
+    settings = &DEFAULT_SETTINGS;
+    numActiveGroups = 0;
+    silentSamples = 0;
+    std::fill(queuedNotes, queuedNotes + MONO_QUEUE - 1, 0);
+    maxBlockSize = 0;
+    blockSamples = 0;
+    numTicks = 0;
+    activeThreads = 1;
+    maxRenderThreads = 1;
 }
 
-void Synth::allocateResources(double sampleRate_, int /*samplesPerBlock*/)
+void Synth::allocateResources(double sampleRate_, int samplesPerBlock, int maxThreads)
 {
     sampleRate = static_cast<float>(sampleRate_);
 
-    // Set filter's samplerate
-    for (int v = 0; v < MAX_VOICES; ++v)
-    {
-        voices[v].filter.sampleRate = sampleRate;
-    }
+    // Scratch space for one block, render() splits longer buffers
+    maxBlockSize = std::max(samplesPerBlock, 1) * Oversampler::MAX_FACTOR;
+    oversampler.allocate(std::max(samplesPerBlock, 1));
+    noiseBuffer.resize(size_t(maxBlockSize));
+    ticks.resize(size_t(maxBlockSize / MIN_CONTROL_INTERVAL + 1));
+    maxThreads = std::clamp(maxThreads, 1, MAX_RENDER_THREADS);
+    partialLeft.resize(size_t(maxThreads * maxBlockSize));
+    partialRight.resize(size_t(maxThreads * maxBlockSize));
+    voiceBuffer.resize(size_t(maxThreads * LANES * maxBlockSize));
+
+    // Helpers are started when the settings ask for them
+    maxRenderThreads = maxThreads;
+    threadPool.stop();
+
+    // Allocate the whole pool up front, so changing the number of voices
+    // never allocates on the audio thread
+    voices.resize(MAX_VOICES);
+    groups.resize(MAX_VOICES / LANES);
+    activeGroups.resize(MAX_VOICES / LANES);
+}
+
+void Synth::startRenderThreads(int numThreads)
+{
+    // There's no point in more helpers than the cores the machine has
+    int cores = juce::SystemStats::getNumCpus();
+    int threads = std::min({ numThreads, maxRenderThreads, cores });
+    threadPool.start(std::max(threads - 1, 0));
 }
 
 void Synth::deallocateResources()
 {
-    // do nothing yet
+    threadPool.stop();
+    noiseBuffer.clear();
+    noiseBuffer.shrink_to_fit();
+    ticks.clear();
+    ticks.shrink_to_fit();
+    partialLeft.clear();
+    partialLeft.shrink_to_fit();
+    partialRight.clear();
+    partialRight.shrink_to_fit();
+    voiceBuffer.clear();
+    voiceBuffer.shrink_to_fit();
+    maxBlockSize = 0;
+
+    voices.clear();
+    voices.shrink_to_fit();
+    groups.clear();
+    groups.shrink_to_fit();
+    activeGroups.clear();
+    activeGroups.shrink_to_fit();
+    numActiveGroups = 0;
+
+    // The settings may go away with the resources, the next user hands
+    // over its own
+    settings = &DEFAULT_SETTINGS;
 }
 
 void Synth::reset()
 {
-    for (int v = 0; v < MAX_VOICES; ++v) {
+    // The voices run oversampled, their filters need to know
+    oversampler.setup(settings->oversampling, settings->oversamplingQuality);
+    oversampler.reset();
+    voiceRate = sampleRate * float(settings->oversampling);
+    float sawLeak = float(std::pow(0.997, 1.0 / settings->oversampling));
+    for (VoiceGroup& group : groups) {
+        group.filter.sampleRate = voiceRate;
+        group.sawLeak = sawLeak;
+    }
+    updateControlRate();
+    noiseGain = std::sqrt(float(settings->oversampling));
+
+    for (int v = 0; v < int(voices.size()); ++v) {
         voices[v].reset();
+        groupOf(v).reset(v % LANES);
     }
+    std::fill(queuedNotes, queuedNotes + MONO_QUEUE - 1, 0);
+    numActiveGroups = 0;
+    silentSamples = 0;
     noiseGen.reset();
     pitchBend = 1.0f; // set to center pos
     // Set inital value of sustain pedal
     sustainPedalPressed = false;
     // Set sample rate and time constant for one pole
-    outputLevelSmoother.reset(sampleRate, 0.05);
+    outputLevelSmoother.reset(sampleRate, SMOOTHING_TIME);
+    // Snap the smoothed parameters to the current settings. They step at
+    // the voice rate.
+    filterQSmoother.reset(voiceRate, SMOOTHING_TIME);
+    filterQSmoother.setCurrentAndTargetValue(settings->filterQ);
+    filterEnvDepthSmoother.reset(voiceRate, SMOOTHING_TIME);
+    filterEnvDepthSmoother.setCurrentAndTargetValue(settings->filterEnvDepth);
+    oscMixSmoother.reset(voiceRate, SMOOTHING_TIME);
+    oscMixSmoother.setCurrentAndTargetValue(settings->oscMix);
+    detuneSmoother.reset(voiceRate, SMOOTHING_TIME);
+    detuneSmoother.setCurrentAndTargetValue(settings->detune);
+    noiseMixSmoother.reset(voiceRate, SMOOTHING_TIME);
+    noiseMixSmoother.setCurrentAndTargetValue(settings->noiseMix);
     // Reset LFO
     lfo = 0.0f;
     lfoStep = 0;
@@ -61,87 +151,275 @@ void Synth::reset()
     filterZip = 0.0f;
 }
 
+void Synth::setSettings(const SynthSettings* newSettings)
+{
+    bool rateChanged = (newSettings->oversampling != settings->oversampling);
+    bool intervalChanged = (newSettings->controlInterval != settings->controlInterval);
+    settings = newSettings;
+
+    // Pitch and envelopes of the sounding voices are in samples at the old
+    // voice rate, so start over
+    if (rateChanged) {
+        reset();
+        return;
+    }
+
+    // The coeffs were set to glide until the next step at the old interval
+    if (intervalChanged) {
+        updateControlRate();
+        lfoStep = std::min(lfoStep, settings->controlInterval);
+        for (VoiceGroup& group : groups) {
+            group.filter.holdCoefficients();
+        }
+    }
+    oversampler.setup(settings->oversampling, settings->oversamplingQuality);
+    outputLevelSmoother.setTargetValue(settings->outputLevel);
+    filterQSmoother.setTargetValue(settings->filterQ);
+    filterEnvDepthSmoother.setTargetValue(settings->filterEnvDepth);
+    oscMixSmoother.setTargetValue(settings->oscMix);
+    detuneSmoother.setTargetValue(settings->detune);
+    noiseMixSmoother.setTargetValue(settings->noiseMix);
+}
+
 void Synth::render(float** outputBuffers, int sampleCount)
 {
     float* outputBufferLeft = outputBuffers[0];
     float* outputBufferRight = outputBuffers[1];
-    
-    // set osc pitch
-    for (int v = 0; v < MAX_VOICES; ++v) {
-        // Render voices
-        Voice& voice = voices[v];
-        if (voice.env.isActive()) {
-            updatePeriod(voice);
-            voice.glideRate = glideRate;
-            voice.filterQ = filterQ * resonanceCtl;
-            voice.pitchBend = pitchBend;
-            voice.filterEnvDepth = filterEnvDepth;
+
+    // Nothing to render into before allocateResources() or after
+    // deallocateResources(), and the block loop below would never end
+    if (maxBlockSize < oversampler.getFactor()) {
+        std::memset(outputBufferLeft, 0, size_t(sampleCount) * sizeof(float));
+        if (outputBufferRight != nullptr) {
+            std::memset(outputBufferRight, 0, size_t(sampleCount) * sizeof(float));
         }
+        return;
     }
 
-    for (int sample = 0; sample < sampleCount; ++sample)
-    {
-        // advance LFO phasor
-        updateLFO();
-
-        // Get noise level for current sample
-        float noise = noiseGen.nextValue() * noiseMix;
+    // Once the last voice has stopped and the oversampling filters ran out,
+    // there's nothing to render
+    if (numActiveGroups == 0) {
+        if (silentSamples >= oversampler.getTailLength()) {
+            skipSilence(outputBuffers, sampleCount);
+            return;
+        }
+        silentSamples += sampleCount;
+    }
+    else {
+        silentSamples = 0;
+    }
 
-        // Reset output
-        float outputLeft = 0.0f;
-        float outputRight = 0.0f;
+    // set osc pitch
+    float detune = detuneSmoother.getCurrentValue();
+    for (int i = 0; i < numActiveGroups; ++i) {
+        int g = activeGroups[size_t(i)];
+        for (int lane = 0; lane < LANES; ++lane) {
+            if (groups[g].env.isActive(lane)) {
+                updatePeriod(g * LANES + lane, detune);
+            }
+        }
+    }
 
-        for (int v = 0; v < MAX_VOICES; ++v) {
-            Voice& voice = voices[v];
-            if (voice.env.isActive()) {
-                // Store noise value if loud enough
-                float output = voice.render(noise);
-                // Apply gain for each channel
-                outputLeft += output * voice.panLeft;
-                outputRight += output * voice.panRight;
+    // Hand out whole groups, but never more threads than groups
+    activeThreads = std::clamp(settings->renderThreads, 1, threadPool.getNumHelpers() + 1);
+    activeThreads = std::min(activeThreads, std::max(numActiveGroups, 1));
+
+    const int factor = oversampler.getFactor();
+    const int maxHostBlock = maxBlockSize / factor;
+    for (int offset = 0; offset < sampleCount; offset += maxHostBlock) {
+        int blockSize = std::min(sampleCount - offset, maxHostBlock);
+        int voiceSamples = blockSize * factor;
+        blockSamples = voiceSamples;
+
+        // The LFO and noise don't depend on the voices, so work them out for
+        // the whole block before the voices are rendered
+        numTicks = 0;
+        for (int sample = 0; sample < voiceSamples; ++sample) {
+            // advance LFO phasor
+            ControlTick& tick = ticks[size_t(numTicks)];
+            if (updateLFO(tick)) {
+                tick.sample = sample;
+                numTicks += 1;
             }
+
+            noiseBuffer[size_t(sample)] = noiseGen.nextValue();
         }
 
-        // Apply output level
-        float outputLevel = outputLevelSmoother.getNextValue();
-        outputLeft *= outputLevel;
-        outputRight *= outputLevel;
+        // Noise level ramps across the block
+        float noiseStart = noiseMixSmoother.getCurrentValue();
+        float noiseEnd = noiseMixSmoother.skip(voiceSamples);
+        applyGainRamp(noiseBuffer.data(), voiceSamples, noiseStart * noiseGain, noiseEnd * noiseGain);
 
-        // Set output in audio buffer
-        // If buffer is stereo, send stereo signal
-        if (outputBufferRight != nullptr) {
-            outputBufferLeft[sample] = outputLeft;
-            outputBufferRight[sample] = outputRight;
-        } // Otherwise send mono
+        // Render voices, each thread into its own partial mix
+        if (activeThreads > 1) {
+            threadPool.run(activeThreads, renderGroupsJob, this);
+        }
         else {
-            outputBufferLeft[sample] = (outputLeft +
-                outputRight) * 0.5f;
+            renderGroups(0, 1, voiceSamples);
+        }
+
+        // Sum the partial mixes into the first one
+        for (int thread = 1; thread < activeThreads; ++thread) {
+            for (int sample = 0; sample < voiceSamples; ++sample) {
+                partialLeft[size_t(sample)] += partialLeft[size_t(thread * maxBlockSize + sample)];
+                partialRight[size_t(sample)] += partialRight[size_t(thread * maxBlockSize + sample)];
+            }
+        }
+
+        // Back to the host rate
+        oversampler.process(partialLeft.data(), partialRight.data(), blockSize);
+
+        for (int sample = 0; sample < blockSize; ++sample)
+        {
+            float outputLeft = partialLeft[size_t(sample)];
+            float outputRight = partialRight[size_t(sample)];
+
+            // Apply output level
+            float outputLevel = outputLevelSmoother.getNextValue();
+            outputLeft *= outputLevel;
+            outputRight *= outputLevel;
+
+            // Set output in audio buffer
+            // If buffer is stereo, send stereo signal
+            if (outputBufferRight != nullptr) {
+                outputBufferLeft[offset + sample] = outputLeft;
+                outputBufferRight[offset + sample] = outputRight;
+            } // Otherwise send mono
+            else {
+                outputBufferLeft[offset + sample] = (outputLeft +
+                    outputRight) * 0.5f;
+            }
         }
     }
 
-    // If voice is silent, reset it's envelope
-    for (int v = 0; v < MAX_VOICES; ++v) {
-        Voice& voice = voices[v];
-        if (!voice.env.isActive()) {
-            voice.env.reset();
-            voice.filter.reset();
+    // If voice is silent, reset it's envelope, and drop the groups that
+    // went silent from the list
+    int stillActive = 0;
+    for (int i = 0; i < numActiveGroups; ++i) {
+        int g = activeGroups[size_t(i)];
+        VoiceGroup& group = groups[g];
+        for (int lane = 0; lane < LANES; ++lane) {
+            if (!group.env.isActive(lane)) {
+                group.env.reset(lane);
+                group.filter.reset(lane);
+            }
+        }
+        if (group.isActive()) {
+            activeGroups[size_t(stillActive++)] = g;
         }
     }
+    numActiveGroups = stillActive;
+
+    protectYourEars(outputBufferLeft, outputBufferRight, sampleCount, safetyCounters);
+}
+
+void Synth::skipSilence(float** outputBuffers, int sampleCount)
+{
+    std::memset(outputBuffers[0], 0, size_t(sampleCount) * sizeof(float));
+    if (outputBuffers[1] != nullptr) {
+        std::memset(outputBuffers[1], 0, size_t(sampleCount) * sizeof(float));
+    }
+
+    // Count the LFO steps that would have happened in this block. Right
+    // after a reset lfoStep is 0, and the first sample steps.
+    int voiceSamples = sampleCount * oversampler.getFactor();
+    int interval = settings->controlInterval;
+    int firstStep = std::max(lfoStep, 1);
+    int steps = 0;
+    if (voiceSamples < firstStep) {
+        lfoStep = firstStep - voiceSamples;
+    }
+    else {
+        int after = voiceSamples - firstStep;
+        steps = 1 + after / interval;
+        lfoStep = interval - after % interval;
+    }
+
+    // Same steps as updateLFO(), without the voice modulation. That's one
+    // sin() per LFO step, and the sound picks up where it would have been.
+    for (int step = 0; step < steps; ++step) {
+        lfo += settings->lfoInc;
+        if (lfo > PI) { lfo -= TWO_PI; }
+
+        const float sine = std::sin(lfo);
+        float filterMod = settings->filterKeyTracking + filterCtl + (settings->filterLFODepth + pressure) * sine;
+        filterZip += filterZipRate * (filterMod - filterZip);
+
+        filterQSmoother.skip(interval);
+        filterEnvDepthSmoother.skip(interval);
+        oscMixSmoother.skip(interval);
+        detuneSmoother.skip(interval);
+    }
+
+    noiseGen.skip(voiceSamples);
+    noiseMixSmoother.skip(voiceSamples);
+    outputLevelSmoother.skip(sampleCount);
+}
+
+void Synth::renderGroupsJob(void* context, int thread)
+{
+    Synth* synth = static_cast<Synth*>(context);
+    synth->renderGroups(thread, synth->activeThreads, synth->blockSamples);
+}
+
+void Synth::renderGroups(int thread, int numThreads, int sampleCount)
+{
+    float* outputLeft = partialLeft.data() + thread * maxBlockSize;
+    float* outputRight = partialRight.data() + thread * maxBlockSize;
+    std::fill(outputLeft, outputLeft + sampleCount, 0.0f);
+    std::fill(outputRight, outputRight + sampleCount, 0.0f);
+
+    float* voiceOutput = voiceBuffer.data() + thread * LANES * maxBlockSize;
+
+    // Every group only touches its own voices, so they can run on any
+    // thread. The voice modulation is applied on the same samples as before.
+    for (int i = thread; i < numActiveGroups; i += numThreads) {
+        int g = activeGroups[size_t(i)];
+        VoiceGroup& group = groups[g];
+
+        // Render the group a segment at a time, from one LFO step to the next
+        int start = 0;
+        for (int tick = 0; tick <= numTicks; ++tick) {
+            int end = (tick < numTicks) ? ticks[size_t(tick)].sample : sampleCount;
+            group.renderBlock(noiseBuffer.data() + start, voiceOutput + start * LANES,
+                end - start, settings->oscEngine == 1);
+            if (tick < numTicks) {
+                updateVoiceModulation(g, ticks[size_t(tick)]);
+            }
+            start = end;
+        }
 
-    protectYourEars(outputBufferLeft, sampleCount);
-    protectYourEars(outputBufferRight, sampleCount);
+        group.mix(voiceOutput, outputLeft, outputRight, sampleCount);
+    }
 }
 
 int Synth::findFreeVoice() const
 {
     int v = 0;
     float l = 100.0f;
-    // Iterate through all voices
-    for (int i = 0; i < MAX_VOICES; ++i) {
+    // Iterate through the voices the patch may use. Free voices all sit at
+    // level 0, so the lowest one wins and sounding voices stay packed into
+    // the first groups. In unison the whole stack has to be free, and it
+    // never straddles two groups. The number of voices counts notes, so
+    // the stacks get more of the pool.
+    int stack = unisonVoices();
+    int poolSize = std::min(settings->numVoices * stack, MAX_VOICES);
+    for (int i = 0; i < poolSize; ++i) {
+        const EnvelopeBank& env = groupOf(i).env;
+        int lane = i % LANES;
+        if (lane % stack != 0 || lane + stack > LANES) { continue; }
+
+        float level = env.level[lane];
+        bool inAttack = env.isInAttack(lane);
+        for (int k = 1; k < stack; ++k) {
+            level = std::max(level, env.level[lane + k]);
+            inAttack = inAttack || env.isInAttack(lane + k);
+        }
+
         // Compare voice level of voices that are not in attack phase
-        if (voices[i].env.level < l && !voices[i].env.isInAttack()) {
+        if (level < l && !inAttack) {
             // Store level of voice
-            l = voices[i].env.level;
+            l = level;
             // & voice number
             v = i;
         }
@@ -150,15 +428,32 @@ int Synth::findFreeVoice() const
     return v;
 }
 
-float Synth::calcPeriod(int v, int note) const
+void Synth::activateGroup(int g)
+{
+    // Keep the list sorted, so the groups are always mixed in the same order
+    int i = numActiveGroups;
+    while (i > 0 && activeGroups[size_t(i - 1)] >= g) {
+        if (activeGroups[size_t(i - 1)] == g) { return; }
+        --i;
+    }
+    for (int j = numActiveGroups; j > i; --j) {
+        activeGroups[size_t(j)] = activeGroups[size_t(j - 1)];
+    }
+    activeGroups[size_t(i)] = g;
+    numActiveGroups += 1;
+}
+
+float Synth::calcPeriod(int v, int note, float unison) const
 {
     // Optimized formula for (sampleRate / freq):
     // sampleRate / (440.0f * std::exp2((float(note - 69) + tune) / 12.0f));
-    float period = tune * std::exp(-0.05776226505f *
-        float(note) + ANALOG * float(v));
+    // Keeps std::exp: the oscillator rounds the half period to whole
+    // samples, so pitch needs full precision, and this only runs per note
+    float period = settings->tune * std::exp(-0.05776226505f *
+        float(note) + ANALOG * float(v % ANALOG_VOICES)) * unison;
 
     // Set limit for highest pitch to avoid BLIT crapping out
-    while (period < 6.0f || (period * detune) < 6.0f) {
+    while (period < 6.0f || (period * settings->detune) < 6.0f) {
         period += period;
     }
     return period;
@@ -205,97 +500,122 @@ void Synth::midiMessage(uint8_t data0, uint8_t data1, uint8_t data2)
 
 void Synth::startVoice(int v, int note, int velocity)
 {
-    // convert note to freq (temperament tuning)
-    float period = calcPeriod(v, note);
-
-    Voice& voice = voices[v];
-    voice.target = period; // Set desired period
-
     int noteDistance = 0;
     // Calc distance only if there's a previous note played
     if (lastNote > 0) {
-        if ((glideMode == 2) || ((glideMode == 1) && isPlayingLegatoStyle())) {
+        if ((settings->glideMode == 2) || ((settings->glideMode == 1) && isPlayingLegatoStyle())) {
             noteDistance = note - lastNote;
         }
     }
+
+    int stack = unisonVoices();
+    for (int k = 0; k < stack; ++k) {
+        startSubVoice(v + k, note, velocity, noteDistance, unisonPosition(k, stack));
+    }
+
+    // Update last note
+    lastNote = note;
+    activateGroup(v / LANES);
+}
+
+void Synth::startSubVoice(int v, int note, int velocity, int noteDistance, float position)
+{
+    // convert note to freq (temperament tuning), unison sub-voices spread
+    // around it
+    float period = calcPeriod(v, note, std::exp2(position * settings->unisonDetune));
+
+    Voice& voice = voices[v];
+    VoiceGroup& group = groupOf(v);
+    int lane = v % LANES;
+    voice.target = period; // Set desired period
+
     // set period to glide from
-    voice.period = period * std::pow(1.059463094359f, float(noteDistance) - glideBend);
+    // 1.059463094359^n written as 2^(n / 12)
+    voice.period = period * FastMath::exp2((float(noteDistance) - settings->glideBend) / 12.0f);
     // Limit voice period value
     if (voice.period < 6.0f) { voice.period = 6.0f;  }
 
-    // Update last note and current note
-    lastNote = note;
+    // Update current note
     voice.note = note;
-    voice.updatePanning();
+    group.updatePanning(lane, note, position * settings->unisonWidth);
 
     // Velocity curve
     float vel = 0.004f * float((velocity + 64) * (velocity + 64)) - 8.0f;
     // activate the first osc
-    voice.osc1.amplitude = volumeTrim * vel; //  (velocity / 127.0f) * 0.5f;
-    // voice.osc1.reset(); // reset restarts the phase, so it can sync oscs
+    group.osc1.amplitude[lane] = settings->volumeTrim * settings->unisonGain * vel; //  (velocity / 127.0f) * 0.5f;
+    // group.osc1.reset(lane); // reset restarts the phase, so it can sync oscs
     // activate the second osc
-    voice.osc2.amplitude = voice.osc1.amplitude * oscMix;
-    // voice.osc2.reset(); 
-    voice.cutoff = sampleRate / (period * PI); //set filter's cutoff related to note
-    voice.cutoff = std::exp(velocitySensitivity * float(velocity - 64));
+    group.osc2.amplitude[lane] = group.osc1.amplitude[lane] * oscMixSmoother.getCurrentValue();
+    // group.osc2.reset(lane); 
+    voice.cutoff = voiceRate / (period * PI); //set filter's cutoff related to note
+    voice.cutoff = FastMath::exp(settings->velocitySensitivity * float(velocity - 64));
 
     // Modulation
-    if (vibrato == 0.0f && pwmDepth > 0.0f) {
-        voice.osc2.squareWave(voice.osc1, voice.period);
+    if (settings->vibrato == 0.0f && settings->pwmDepth > 0.0f) {
+        group.osc2.squareWave(lane, group.osc1, voice.period);
+        group.blep2.squareWave(lane, group.blep1);
     }
 
     // Envelope
-    Envelope& env = voice.env;
-    env.attackMultiplier = envAttack;
-    env.decayMultiplier = envDecay;
-    env.sustainLevel = envSustain;
-    env.releaseMultiplier = envRelease;
-    env.attack();
+    EnvelopeBank& env = group.env;
+    env.attackMultiplier[lane] = settings->envAttack;
+    env.decayMultiplier[lane] = settings->envDecay;
+    env.sustainLevel[lane] = settings->envSustain;
+    env.releaseMultiplier[lane] = settings->envRelease;
+    env.attack(lane);
 
     // Filter Envelope
-    Envelope& filterEnv = voice.filterEnv;
-    filterEnv.attackMultiplier = filterAttack;
-    filterEnv.decayMultiplier = filterDecay;
-    filterEnv.sustainLevel = filterSustain;
-    filterEnv.releaseMultiplier = filterRelease;
-    filterEnv.attack();
+    EnvelopeBank& filterEnv = group.filterEnv;
+    filterEnv.attackMultiplier[lane] = settings->filterAttack;
+    filterEnv.decayMultiplier[lane] = settings->filterDecay;
+    filterEnv.sustainLevel[lane] = settings->filterSustain;
+    filterEnv.releaseMultiplier[lane] = settings->filterRelease;
+    filterEnv.attack(lane);
 }
 
 void Synth::restartMonoVoice(int note, int velocity)
 {
-    // Calculate period
-    float period = calcPeriod(0, note);
-    // Assign values to voice 0
-    Voice& voice = voices[0];
-    voice.target = period; // if glide is set
-    // If no glide is set
-    if (glideMode == 0) { voice.period = period; }
-    // Set level above threshold so it's not muted
-    voice.env.level += SILENCE + SILENCE;
-    voice.note = note;
-    voice.updatePanning();
+    // The unison stack of voice 0 sits in the first lanes of group 0
+    int stack = unisonVoices();
+    for (int k = 0; k < stack; ++k) {
+        float position = unisonPosition(k, stack);
+        // Calculate period
+        float period = calcPeriod(k, note, std::exp2(position * settings->unisonDetune));
+        // Assign values to voice k
+        Voice& voice = voices[k];
+        voice.target = period; // if glide is set
+        // If no glide is set
+        if (settings->glideMode == 0) { voice.period = period; }
+        // Set level above threshold so it's not muted
+        groupOf(k).env.level[k] += SILENCE + SILENCE;
+        voice.note = note;
+        groupOf(k).updatePanning(k, note, position * settings->unisonWidth);
+    }
+    activateGroup(0);
 }
 
 void Synth::shiftQueuedNotes()
 {
-    for (int tmp = MAX_VOICES - 1; tmp > 0; tmp--) {
-        // Trigger release of voice
-        voices[tmp].release();
-        voices[tmp].note = voices[tmp - 1].note;
+    for (int tmp = MONO_QUEUE - 1; tmp > 0; tmp--) {
+        // Trigger release of the lanes the unison stack doesn't use
+        if (tmp >= unisonVoices()) {
+            groupOf(tmp).release(tmp % LANES);
+        }
+    }
+    for (int i = MONO_QUEUE - 2; i > 0; i--) {
+        queuedNotes[i] = queuedNotes[i - 1];
     }
+    queuedNotes[0] = voices[0].note;
 }
 
 int Synth::nextQueuedNote()
 {
-    int held = 0;
-    for (int v = MAX_VOICES - 1; v > 0; v--) {
-        if (voices[v].note > 0) { held = v; }
-    }
-
-    if (held > 0) {
-        int note = voices[held].note;
-        voices[held].note = 0;
-        return note;
+    for (int i = 0; i < MONO_QUEUE - 1; ++i) {
+        if (queuedNotes[i] > 0) {
+            int note = queuedNotes[i];
+            queuedNotes[i] = 0;
+            return note;
+        }
     }
 
     return 0;
@@ -303,11 +623,13 @@ int Synth::nextQueuedNote()
 
 void Synth::noteOn(int note, int velocity)
 {
-    if (ignoreVelocity) { velocity = 80; }
+    if (settings->ignoreVelocity) { velocity = 80; }
+    // No voices before allocateResources()
+    if (voices.empty()) { return; }
 
     int v = 0;
     // If monophonic
-    if (numVoices == 1) {
+    if (settings->numVoices == 1) {
         if (voices[0].note > 0) {
             // Shift voices
             shiftQueuedNotes();
@@ -324,23 +646,30 @@ void Synth::noteOn(int note, int velocity)
 
 void Synth::noteOff(int note)
 {
-    if ((numVoices == 1) && (voices[0].note == note)) {
+    if ((settings->numVoices == 1) && (voices[0].note == note)) {
         int queuedNote = nextQueuedNote();
         if (queuedNote > 0) {
             restartMonoVoice(queuedNote, -1);
         }
     }
 
-    for (int v = 0; v < MAX_VOICES; v++) {
+    for (int v = 0; v < int(voices.size()); v++) {
         if (voices[v].note == note) {
             if (sustainPedalPressed) {
                 voices[v].note = SUSTAIN;
             } else {
-                voices[v].release();
+                groupOf(v).release(v % LANES);
                 voices[v].note = 0;
             }
         }
     }
+
+    // Released notes drop out of the mono queue too
+    for (int i = 0; i < MONO_QUEUE - 1; ++i) {
+        if (queuedNotes[i] == note) {
+            queuedNotes[i] = sustainPedalPressed ? SUSTAIN : 0;
+        }
+    }
 }
 
 void Synth::controlChange(uint8_t data1, uint8_t data2)
@@ -361,9 +690,12 @@ void Synth::controlChange(uint8_t data1, uint8_t data2)
         // Unaccounted messages reset synth voices.
         default:
             if (data1 >= 0x78) {
-                for (int v = 0; v < MAX_VOICES; ++v) {
+                for (int v = 0; v < int(voices.size()); ++v) {
                     voices[v].reset();
+                    groupOf(v).reset(v % LANES);
                 }
+                std::fill(queuedNotes, queuedNotes + MONO_QUEUE - 1, 0);
+                numActiveGroups = 0;
                 sustainPedalPressed = false;
             }
             break;
@@ -382,46 +714,119 @@ void Synth::controlChange(uint8_t data1, uint8_t data2)
     }
 }
 
-void Synth::updateLFO()
+bool Synth::updateLFO(ControlTick& tick)
 {
     // Condition to run in lower sample rate
-    if (--lfoStep <= 0) {
-        lfoStep = LFO_MAX;
-
-        lfo += lfoInc; // Increment phasor
-        if (lfo > PI) { lfo -= TWO_PI; } // Reset phasor if out of bounds
+    if (--lfoStep > 0) { return false; }
+    const int interval = settings->controlInterval;
+    lfoStep = interval;
+
+    lfo += settings->lfoInc; // Increment phasor
+    if (lfo > PI) { lfo -= TWO_PI; } // Reset phasor if out of bounds
+
+    const float sine = std::sin(lfo); // Get sine from phasor
+
+    // Set modulation for pitch
+    tick.vibratoMod = 1.0f + sine * (modWheel + settings->vibrato);
+    tick.pwm = 1.0f + sine * (modWheel + settings->pwmDepth);
+
+    // Filter Freq needs no smoother of its own, filterZip already smooths it
+    float filterMod = settings->filterKeyTracking + filterCtl + (settings->filterLFODepth + pressure) * sine;
+    // Smooth filter mod
+    filterZip += filterZipRate * (filterMod - filterZip);
+    tick.filterZip = filterZip;
+
+    // Advance the smoothed parameters by one LFO step
+    tick.filterQ = filterQSmoother.skip(interval);
+    tick.filterEnvDepth = filterEnvDepthSmoother.skip(interval);
+    tick.oscMix = oscMixSmoother.skip(interval);
+    tick.detune = detuneSmoother.skip(interval);
+    return true;
+}
 
-        const float sine = std::sin(lfo); // Get sine from phasor
+void Synth::updateVoiceModulation(int g, const ControlTick& tick)
+{
+    const float Q = tick.filterQ * resonanceCtl;
 
-        // Set modulation for pitch
-        float vibratoMod = 1.0f + sine * (modWheel + vibrato);
-        float pwm = 1.0f + sine * (modWheel + pwmDepth);
+    // add mod to each voice of the group
+    VoiceGroup& group = groups[g];
+    LaneMask active[LANES];
+    for (int lane = 0; lane < LANES; ++lane) {
+        active[lane] = laneMask(group.env.isActive(lane));
+    }
 
-        float filterMod = filterKeyTracking + filterCtl + (filterLFODepth + pressure) * sine;
-        // Smooth filter mod
-        filterZip += 0.005f * (filterMod - filterZip);
+    float fenv[LANES];
+    group.filterEnv.nextValue(active, fenv);
 
-        // add mod to each voice
-        for (int v = 0; v < MAX_VOICES; ++v) {
+    float cutoff[LANES];
+    for (int lane = 0; lane < LANES; ++lane) {
+        cutoff[lane] = 1000.0f; // anything valid for silent lanes
+        if (active[lane] != 0) {
+            int v = g * LANES + lane;
             Voice& voice = voices[v];
-            if (voice.env.isActive()) {
-                voice.osc1.modulation = vibratoMod;
-                voice.osc2.modulation = pwm;
-                voice.filterMod = filterZip;
-                // Glide
-                voice.updateLFO();
-                updatePeriod(voice);
+            group.osc1.modulation[lane] = tick.vibratoMod;
+            group.osc2.modulation[lane] = tick.pwm;
+            group.osc2.amplitude[lane] = group.osc1.amplitude[lane] * tick.oscMix;
+
+            // one pole to reach pitch target
+            voice.period += settings->glideRate * (voice.target - voice.period);
+            updatePeriod(v, tick.detune);
+
+            cutoff[lane] = voice.cutoff;
+        }
+    }
+
+    // The filter math runs on all lanes at once, with the fast kernels
+    float modulatedCutoff[LANES];
+    int stack = unisonVoices();
+    if (stack == 1) {
+        for (int lane = 0; lane < LANES; ++lane) {
+            modulatedCutoff[lane] = modulateCutoff(cutoff[lane], fenv[lane], tick);
+        }
+    }
+    else {
+        // The sub-voices of a note start together, so their cutoff and
+        // filter envelope match the first lane of the stack. The cutoff is
+        // only worked out again for a lane where they don't.
+        for (int lane = 0; lane < LANES; ++lane) {
+            int first = lane - lane % stack;
+            if (first != lane && cutoff[lane] == cutoff[first] && fenv[lane] == fenv[first]) {
+                modulatedCutoff[lane] = modulatedCutoff[first];
+            }
+            else {
+                modulatedCutoff[lane] = modulateCutoff(cutoff[lane], fenv[lane], tick);
             }
         }
     }
+    // Gliding gets the coeffs there by the next step, so a coarse control
+    // rate doesn't step the filter audibly
+    int rampLength = settings->interpolateFilter ? settings->controlInterval : 0;
+    group.filter.updateCoefficients(active, modulatedCutoff, Q, rampLength, stack);
+}
+
+float Synth::modulateCutoff(float cutoff, float fenv, const ControlTick& tick) const
+{
+    float modulatedCutoff = cutoff * FastMath::exp(tick.filterZip + tick.filterEnvDepth + fenv) / pitchBend;
+    return std::clamp(modulatedCutoff, 30.0f, 20000.0f);
+}
+
+void Synth::updateControlRate()
+{
+    // filterZip was tuned for one step every DEFAULT_CONTROL_INTERVAL
+    // samples at the plain sample rate
+    double steps = double(settings->controlInterval) / double(DEFAULT_CONTROL_INTERVAL * settings->oversampling);
+    filterZipRate = float(1.0 - std::pow(0.995, steps));
 }
 
 // Check voices that are still playing
 bool Synth::isPlayingLegatoStyle() const
 {
     int held = 0;
-    for (int i = 0; i < MAX_VOICES; ++i) {
+    for (int i = 0; i < int(voices.size()); ++i) {
         if (voices[i].note > 0) { held += 1; }
     }
+    for (int i = 0; i < MONO_QUEUE - 1; ++i) {
+        if (queuedNotes[i] > 0) { held += 1; }
+    }
     return held > 0;
 }
\ No newline at end of file
@@ -13,68 +13,68 @@
 #include <JuceHeader.h>
 #include "Voice.h"
 #include "NoiseGenerator.h"
+#include "RenderThreadPool.h"
+#include "Oversampler.h"
+#include "SynthSettings.h"
+#include "Utils.h"
 
 class Synth
 {
 public:
     Synth();
 
-    void allocateResources(double sampleRAte, int samplesPerBlock);
+    // maxThreads limits how many threads may ever share the voices. No
+    // helper runs until startRenderThreads() asks for one.
+    void allocateResources(double sampleRAte, int samplesPerBlock, int maxThreads = MAX_RENDER_THREADS);
     void deallocateResources();
+
+    // Starts helpers so numThreads threads, the audio thread included, can
+    // share the voices. Call it from the message thread before settings
+    // with more render threads go out, the audio thread may keep
+    // rendering. Helpers are only stopped by allocateResources() and
+    // deallocateResources().
+    void startRenderThreads(int numThreads);
     void reset();
     void render(float** outputBuffers, int sampleCount);
     void midiMessage(uint8_t data0, uint8_t data1, uint8_t data2);
 
-    // Voice elements
-    float noiseMix;
-    float oscMix;
-    float detune;
+    // What the output safety stage had to do so far, safe to read from any
+    // thread
+    const OutputSafetyCounters& getSafetyCounters() const { return safetyCounters; }
 
-    // Global tuning
-    float tune;
+    // True when render() would only write silence
+    bool isIdle() const { return numActiveGroups == 0 && silentSamples >= oversampler.getTailLength(); }
 
-    // Envelope elements
-    float envAttack;
-    float envDecay;
-    float envSustain;
-    float envRelease;
+    // Takes a new set of derived settings. The synth only keeps the pointer,
+    // so the settings must stay valid until the next call.
+    void setSettings(const SynthSettings* newSettings);
 
     // Polyphony
-    static constexpr int MAX_VOICES = 8;
-    int numVoices;
-
-    // Gain adjustment
-    float volumeTrim;
-    float velocitySensitivity;
-    bool ignoreVelocity;
+    static constexpr int MAX_VOICES = 128; // size of the voice pool
+    static_assert(MAX_VOICES % LANES == 0, "voices must fill whole groups");
+    static constexpr int MONO_QUEUE = 8; // notes remembered in mono mode, with the one playing
 
     // Output Level Slider
     juce::LinearSmoothedValue<float> outputLevelSmoother;
 
-    // Modulation
-    const int LFO_MAX = 32; // Downsampling factor
-    float lfoInc;
-    float vibrato;
+    // Modulation runs at the control rate, once every controlInterval
+    // samples at the voice rate (see SynthSettings)
+    static constexpr int DEFAULT_CONTROL_INTERVAL = 32;
+    static constexpr int MIN_CONTROL_INTERVAL = 8;
+    static constexpr int MAX_CONTROL_INTERVAL = 512;
 
-    // PWM
-    float pwmDepth;
-
-    // Glide
-    int glideMode;
-    float glideRate;
-    float glideBend;
-
-    // Filter
-    float filterKeyTracking;
-    float filterQ;
-    float filterLFODepth;
-
-    // Filter Envelope
-    float filterAttack, filterDecay, filterSustain, filterRelease;
-    float filterEnvDepth;
+    // Settings may ask for more render threads than there are helpers,
+    // the synth then uses the ones it has
+    static constexpr int MAX_RENDER_THREADS = 4;
 
 private:
+    // Lets the benchmarks in Tools/JX11Bench time private steps like updateLFO()
+    friend class SynthBenchmark;
+
+    // Starts the note on voice v and, in unison, on the sub-voices in the
+    // lanes after it
     void startVoice(int v, int note, int velocity);
+    void startSubVoice(int v, int note, int velocity, int noteDistance, float position);
     void restartMonoVoice(int note, int velocity);
     void shiftQueuedNotes();
     int nextQueuedNote();
@@ -85,32 +85,115 @@ private:
     // Polyphony voice mgmt
     int findFreeVoice() const;
 
-    // Optimized period calculation
-    float calcPeriod(int v, int note) const;
+    // Unison: every note plays unisonVoices() sub-voices in neighbouring
+    // lanes of one group, the stack starts at a lane that is a multiple of
+    // its size. The sub-voices share the filter cutoff and coeffs of the
+    // stack's first lane (see updateVoiceModulation).
+    int unisonVoices() const { return std::clamp(settings->unisonVoices, 1, LANES); }
+
+    // Where sub-voice k sits in the stack, from -1 to 1
+    static float unisonPosition(int k, int stack)
+    {
+        return (stack > 1) ? 2.0f * float(k) / float(stack - 1) - 1.0f : 0.0f;
+    }
+
+    // Notes waiting in mono mode, the newest first. SUSTAIN marks notes
+    // released while the pedal is down.
+    int queuedNotes[MONO_QUEUE - 1];
+
+    // Optimized period calculation. unison scales the period of a unison
+    // sub-voice, before the limit for the highest pitch is applied.
+    float calcPeriod(int v, int note, float unison = 1.0f) const;
 
     float sampleRate;
-    std::array<Voice, MAX_VOICES> voices;
+    float voiceRate; // sampleRate times the oversampling factor
+    const SynthSettings* settings;
+    std::vector<Voice> voices; // allocated in allocateResources()
+    std::vector<VoiceGroup> groups;
     NoiseGenerator noiseGen;
 
+    // Groups with at least one sounding voice, in ascending order. Only
+    // these are visited while rendering, so idle voices cost nothing.
+    std::vector<int> activeGroups;
+    int numActiveGroups;
+    void activateGroup(int g);
+
+    // Voice v lives in lane (v % LANES) of group (v / LANES)
+    inline VoiceGroup& groupOf(int v) { return groups[size_t(v / LANES)]; }
+    inline const VoiceGroup& groupOf(int v) const { return groups[size_t(v / LANES)]; }
+
     float pitchBend;
 
     bool sustainPedalPressed;
 
-    // Modulation
-    void updateLFO();
+    // Modulation that is shared by all voices, worked out once per LFO step
+    struct ControlTick
+    {
+        int sample; // position in the block
+        float vibratoMod;
+        float pwm;
+        float filterZip;
+
+        // Smoothed parameters
+        float filterQ;
+        float filterEnvDepth;
+        float oscMix;
+        float detune;
+    };
+    bool updateLFO(ControlTick& tick);
+    void updateVoiceModulation(int g, const ControlTick& tick);
+    float modulateCutoff(float cutoff, float fenv, const ControlTick& tick) const;
+
+    // Renders the groups g, g + numThreads, ... into the partial mix of
+    // that thread
+    void renderGroups(int thread, int numThreads, int sampleCount);
+    static void renderGroupsJob(void* context, int thread);
+
+    // Used instead of rendering while nothing sounds: clears the output and
+    // moves the LFO and smoothers ahead by the time that passed
+    void skipSilence(float** outputBuffers, int sampleCount);
+    int silentSamples; // rendered since the last voice stopped
+
+    // The scratch buffers are in samples at the voice rate, they have room
+    // for the largest host block at the largest oversampling factor
+    int maxBlockSize;
+    int blockSamples; // length of the block being rendered
+    std::vector<float> noiseBuffer;
+    std::vector<ControlTick> ticks;
+    int numTicks;
+    std::vector<float> partialLeft, partialRight; // one block per thread
+    std::vector<float> voiceBuffer; // LANES outputs per sample, per thread
+    int activeThreads;
+    int maxRenderThreads; // as given to allocateResources()
+    RenderThreadPool threadPool;
+
+    // Takes the voice sum back down to the host rate
+    Oversampler oversampler;
+
+    OutputSafetyCounters safetyCounters;
 
     int lfoStep;
     float lfo;
 
+    // The continuous parameters glide to new settings instead of jumping
+    // once per block. Most are read once per LFO step, noise every sample.
+    juce::LinearSmoothedValue<float> filterQSmoother;
+    juce::LinearSmoothedValue<float> filterEnvDepthSmoother;
+    juce::LinearSmoothedValue<float> oscMixSmoother;
+    juce::LinearSmoothedValue<float> detuneSmoother;
+    juce::LinearSmoothedValue<float> noiseMixSmoother;
+
     // Mod wheel
     float modWheel;
 
     // Glide
     int lastNote;
-    inline void updatePeriod(Voice& voice)
+    inline void updatePeriod(int v, float detune)
     {
-        voice.osc1.period = voice.period * pitchBend;
-        voice.osc2.period = voice.osc1.period * detune;
+        VoiceGroup& group = groupOf(v);
+        int lane = v % LANES;
+        group.osc1.period[lane] = voices[v].period * pitchBend;
+        group.osc2.period[lane] = group.osc1.period[lane] * detune;
     }
 
     bool isPlayingLegatoStyle() const;
@@ -120,4 +203,11 @@ private:
     float pressure;
     float filterCtl;
     float filterZip;
+
+    // Keep the sound the same when oversampling or at another control
+    // rate: the filter smoothing runs once per LFO step, and white noise
+    // spreads over the wider band
+    float filterZipRate;
+    void updateControlRate();
+    float noiseGain;
 };
\ No newline at end of file
@@ -0,0 +1,228 @@
+/*
+  ==============================================================================
+
+    SynthParameters.cpp
+    Created: 17 Oct 2026 11:52:17am
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#include "SynthParameters.h"
+
+// True if any of the parameters in bits changed
+static inline bool changedAny(ParameterMask changed, ParameterMask bits)
+{
+    return (changed & bits) != 0;
+}
+
+const char* const CONTROL_RATE_NAMES[NUM_CONTROL_RATES] = {
+    "32 Samples", "64 Samples", "128 Samples", "1.5 kHz", "750 Hz", "375 Hz"
+};
+
+int controlIntervalFor(int choice, float voiceRate)
+{
+    static const int samples[] = { 32, 64, 128 };
+    static const float hertz[] = { 1500.0f, 750.0f, 375.0f };
+    choice = std::clamp(choice, 0, NUM_CONTROL_RATES - 1);
+
+    int interval = (choice < 3) ? samples[choice] : int(std::lround(voiceRate / hertz[choice - 3]));
+    return std::clamp(interval, Synth::MIN_CONTROL_INTERVAL, Synth::MAX_CONTROL_INTERVAL);
+}
+
+void applyParameters(SynthSettings& settings, const float* param, float sampleRate, ParameterMask changed)
+{
+    float inverseSampleRate = 1.0f / sampleRate;
+
+    // Envelope
+    if (changedAny(changed, parameterBit(PARAM_ENV_ATTACK))) {
+        settings.envAttack = std::exp(-inverseSampleRate
+            * std::exp(5.5f - 0.075f *
+                param[PARAM_ENV_ATTACK]));
+    }
+
+    if (changedAny(changed, parameterBit(PARAM_ENV_DECAY))) {
+        settings.envDecay = std::exp(-inverseSampleRate
+            * std::exp(5.5f - 0.075f *
+                param[PARAM_ENV_DECAY]));
+    }
+
+    if (changedAny(changed, parameterBit(PARAM_ENV_SUSTAIN))) {
+        settings.envSustain = param[PARAM_ENV_SUSTAIN] * 1e-2f;
+    }
+
+    if (changedAny(changed, parameterBit(PARAM_ENV_RELEASE))) {
+        float envRelease = param[PARAM_ENV_RELEASE];
+        if (envRelease < 1.0f) {
+            settings.envRelease = 0.75f;
+        }
+        else {
+            settings.envRelease = std::exp(-inverseSampleRate
+                * std::exp(5.5f - 0.075f * envRelease));
+        }
+        settings.releaseSeconds = std::log(SILENCE) / std::log(settings.envRelease) * inverseSampleRate;
+    }
+
+    // Noise paramChange
+    if (changedAny(changed, parameterBit(PARAM_NOISE))) {
+        float noiseMix = param[PARAM_NOISE] * 1e-2f;
+        noiseMix *= noiseMix;
+        settings.noiseMix = noiseMix * 0.06f;
+    }
+
+    // Filter
+    if (changedAny(changed, parameterBit(PARAM_FILTER_FREQ))) {
+        settings.filterKeyTracking = 0.08f * param[PARAM_FILTER_FREQ] - 1.5f;
+    }
+
+    float filterReso = param[PARAM_FILTER_RESO] / 100.0f;
+    if (changedAny(changed, parameterBit(PARAM_FILTER_RESO))) {
+        settings.filterQ = std::exp(3.0f * filterReso);
+    }
+
+    if (changedAny(changed, parameterBit(PARAM_FILTER_LFO))) {
+        float filterLFO = param[PARAM_FILTER_LFO] / 100.0f;
+        settings.filterLFODepth = 2.5f * filterLFO * filterLFO;
+    }
+
+    // Oscillator engine
+    if (changedAny(changed, parameterBit(PARAM_OSC_ENGINE))) {
+        settings.oscEngine = int(param[PARAM_OSC_ENGINE]);
+    }
+
+    // Osc Mix
+    if (changedAny(changed, parameterBit(PARAM_OSC_MIX))) {
+        settings.oscMix = param[PARAM_OSC_MIX] * 1e-2f;
+    }
+
+    // Adjust voice gain based on mix levels
+    if (changedAny(changed, parameterBit(PARAM_OSC_MIX) | parameterBit(PARAM_NOISE)
+                            | parameterBit(PARAM_FILTER_RESO))) {
+        settings.volumeTrim = 0.0008f * (3.2f - settings.oscMix - 25.0f * settings.noiseMix) * (1.5f - 0.5f * filterReso);
+    }
+
+    // Detune between oscs
+    if (changedAny(changed, parameterBit(PARAM_OSC_TUNE) | parameterBit(PARAM_OSC_FINE))) {
+        float semi = param[PARAM_OSC_TUNE];
+        float cent = param[PARAM_OSC_FINE];
+        settings.detune = std::pow(1.059463094359f, -semi - 0.01f * cent); // 2^(-semi - ...)/12
+    }
+
+    // Velocity
+    if (changedAny(changed, parameterBit(PARAM_FILTER_VELOCITY))) {
+        float filterVelocity = param[PARAM_FILTER_VELOCITY];
+        if (filterVelocity < -90.0f) {
+            settings.velocitySensitivity = 0.0f;
+            settings.ignoreVelocity = true;
+        }
+        else {
+            settings.velocitySensitivity = 0.0005f * filterVelocity;
+            settings.ignoreVelocity = false;
+        }
+    }
+
+    // Output Level
+    if (changedAny(changed, parameterBit(PARAM_OUTPUT_LEVEL))) {
+        settings.outputLevel = juce::Decibels::decibelsToGain(param[PARAM_OUTPUT_LEVEL]);
+    }
+
+    // Global tuning
+    if (changedAny(changed, parameterBit(PARAM_OCTAVE) | parameterBit(PARAM_TUNING))) {
+        float octave = param[PARAM_OCTAVE];
+        float tuning = param[PARAM_TUNING];
+
+        // Optimized freq calc
+        float tuneInSemi = -36.3763f - 12.0f * octave - tuning * 1e-2f;
+
+        // settings.tune = octave * 12.0f + tuning * 1e-2f;
+        settings.tune = sampleRate * std::exp(0.05776226505f *
+            tuneInSemi);
+    }
+
+    // Polyphony
+    if (changedAny(changed, parameterBit(PARAM_POLY_MODE) | parameterBit(PARAM_VOICES))) {
+        // Voices is a choice of 8, 16, 32, 64 or 128
+        int polyVoices = std::min(8 << int(param[PARAM_VOICES]), Synth::MAX_VOICES);
+        settings.numVoices = (int(param[PARAM_POLY_MODE]) == 0) ? 1 : polyVoices;
+    }
+
+    // Unison
+    if (changedAny(changed, parameterBit(PARAM_UNISON))) {
+        // Unison is a choice of 1 to 8 sub-voices
+        settings.unisonVoices = std::min(int(param[PARAM_UNISON]) + 1, LANES);
+        settings.unisonGain = 1.0f / std::sqrt(float(settings.unisonVoices));
+    }
+
+    if (changedAny(changed, parameterBit(PARAM_UNISON_DETUNE))) {
+        // Up to 50 cents either side
+        settings.unisonDetune = param[PARAM_UNISON_DETUNE] / 2400.0f;
+    }
+
+    if (changedAny(changed, parameterBit(PARAM_UNISON_WIDTH))) {
+        settings.unisonWidth = param[PARAM_UNISON_WIDTH] / 100.0f;
+    }
+
+    // Modulation
+    const float inverseUpdateRate = inverseSampleRate * float(settings.controlInterval);
+
+    // Filter Env
+    if (changedAny(changed, parameterBit(PARAM_FILTER_ATTACK))) {
+        settings.filterAttack = std::exp(-inverseUpdateRate *
+            std::exp(5.5f - 0.075f * param[PARAM_FILTER_ATTACK]));
+    }
+
+    if (changedAny(changed, parameterBit(PARAM_FILTER_DECAY))) {
+        settings.filterDecay = std::exp(-inverseUpdateRate *
+            std::exp(5.5f - 0.075f * param[PARAM_FILTER_DECAY]));
+    }
+
+    if (changedAny(changed, parameterBit(PARAM_FILTER_SUSTAIN))) {
+        float filterSustain = param[PARAM_FILTER_SUSTAIN] / 100.0f;
+        settings.filterSustain = filterSustain * filterSustain;
+    }
+
+    if (changedAny(changed, parameterBit(PARAM_FILTER_RELEASE))) {
+        settings.filterRelease = std::exp(-inverseUpdateRate *
+            std::exp(5.5f - 0.075f * param[PARAM_FILTER_RELEASE]));
+    }
+
+    if (changedAny(changed, parameterBit(PARAM_FILTER_ENV))) {
+        settings.filterEnvDepth = 0.06f * param[PARAM_FILTER_ENV];
+    }
+
+    // LFO Phasor
+    if (changedAny(changed, parameterBit(PARAM_LFO_RATE))) {
+        float lfoRate = std::exp(7.0f * param[PARAM_LFO_RATE] - 4.0f);
+        settings.lfoInc = lfoRate * inverseUpdateRate * float(TWO_PI);
+    }
+
+    if (changedAny(changed, parameterBit(PARAM_VIBRATO))) {
+        float vibrato = param[PARAM_VIBRATO] / 200.0f;
+        settings.vibrato = 0.2f * vibrato * vibrato;
+
+        // PWM Depth
+        settings.pwmDepth = settings.vibrato;
+        if (vibrato < 0.0f) { settings.vibrato = 0.0f; }
+    }
+
+    // Glide
+    if (changedAny(changed, parameterBit(PARAM_GLIDE_MODE))) {
+        settings.glideMode = int(param[PARAM_GLIDE_MODE]);
+    }
+
+    if (changedAny(changed, parameterBit(PARAM_GLIDE_RATE))) {
+        float glideRate = param[PARAM_GLIDE_RATE];
+        if (glideRate < 2.0f) {
+            settings.glideRate = 1.0f; // no glide
+        }
+        else {
+            settings.glideRate = 1.0f - std::exp(-inverseUpdateRate *
+                std::exp(6.0f - 0.07f * glideRate)
+            );
+        }
+    }
+
+    if (changedAny(changed, parameterBit(PARAM_GLIDE_BEND))) {
+        settings.glideBend = param[PARAM_GLIDE_BEND];
+    }
+}
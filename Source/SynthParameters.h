@@ -0,0 +1,43 @@
+/*
+  ==============================================================================
+
+    SynthParameters.h
+    Created: 17 Oct 2026 11:52:17am
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "Synth.h"
+#include "Preset.h"
+
+// One bit per ParameterIndex, to tell which parameters changed
+using ParameterMask = uint64_t;
+static_assert(NUM_PARAMS < 64, "every parameter needs a bit");
+
+inline ParameterMask parameterBit(int index)
+{
+    return ParameterMask(1) << index;
+}
+
+const ParameterMask ALL_PARAMETERS = (ParameterMask(1) << NUM_PARAMS) - 1;
+
+// Choices of the Control Rate parameter. The first ones are a number of
+// samples at the voice rate, the others a rate in Hz that stays the same
+// whatever the sample rate is.
+const int NUM_CONTROL_RATES = 6;
+extern const char* const CONTROL_RATE_NAMES[NUM_CONTROL_RATES];
+
+// Samples at the voice rate between two control steps for a choice
+int controlIntervalFor(int choice, float voiceRate);
+
+// Calculates the synth's derived settings from plain parameter values, in the
+// same units and order as Preset::param (see ParameterIndex). Only the values
+// that depend on a parameter in changed are recalculated; pass ALL_PARAMETERS
+// after a sample rate or control rate change. renderThreads, controlInterval
+// and interpolateFilter aren't touched, but the rates that depend on
+// controlInterval are worked out for it.
+void applyParameters(SynthSettings& settings, const float* param, float sampleRate,
+                     ParameterMask changed = ALL_PARAMETERS);
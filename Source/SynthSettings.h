@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    SynthSettings.h
+    Created: 17 Oct 2026 7:04:51pm
+    Author:  garam
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+
+// Everything the synth derives from the parameters. It's worked out away
+// from the audio thread (see applyParameters) and handed to the synth as a
+// finished snapshot, so rendering never does parameter math.
+struct SynthSettings
+{
+    // Voice elements
+    int oscEngine = 0; // 0 = BLIT, 1 = PolyBLEP
+    float noiseMix = 0.0f;
+    float oscMix = 0.0f;
+    float detune = 1.0f;
+
+    // Global tuning
+    float tune = 0.0f;
+
+    // Envelope elements
+    float envAttack = 0.0f;
+    float envDecay = 0.0f;
+    float envSustain = 0.0f;
+    float envRelease = 0.0f;
+
+    // Time for a released voice to fall from full level to silence
+    float releaseSeconds = 0.0f;
+
+    // Polyphony
+    int numVoices = 1;
+
+    // Unison
+    int unisonVoices = 1; // sub-voices per note
+    float unisonDetune = 0.0f; // octaves from the middle to the outer sub-voices
+    float unisonWidth = 0.0f; // pan offset of the outer sub-voices
+    float unisonGain = 1.0f; // keeps a stack about as loud as one voice
+
+    // Gain adjustment
+    float volumeTrim = 0.0f;
+    float velocitySensitivity = 0.0f;
+    bool ignoreVelocity = false;
+
+    // Output level as a gain, the synth smooths towards it
+    float outputLevel = 1.0f;
+
+    // Modulation
+    float lfoInc = 0.0f;
+    float vibrato = 0.0f;
+
+    // PWM
+    float pwmDepth = 0.0f;
+
+    // Glide
+    int glideMode = 0;
+    float glideRate = 1.0f;
+    float glideBend = 0.0f;
+
+    // Filter
+    float filterKeyTracking = 0.0f;
+    float filterQ = 1.0f;
+    float filterLFODepth = 0.0f;
+
+    // Filter Envelope
+    float filterAttack = 0.0f, filterDecay = 0.0f, filterSustain = 0.0f, filterRelease = 0.0f;
+    float filterEnvDepth = 0.0f;
+
+    // The LFO, glide and filter run once every controlInterval samples at
+    // the voice rate. interpolateFilter glides the filter coeffs from one
+    // step to the next instead of jumping.
+    int controlInterval = 32;
+    bool interpolateFilter = false;
+
+    // Threads that share the voices of a block, the audio thread included
+    int renderThreads = 1;
+
+    // The voices run at the sample rate times this (1, 2 or 4), everything
+    // that depends on the rate above is worked out for that rate
+    int oversampling = 1;
+    int oversamplingQuality = 0; // 0 = Normal, 1 = High
+
+    // Program changes and CC 7 from MIDI, and program changes from the host,
+    // that were already in the parameters when these settings were worked
+    // out, counted by the plug-in
+    uint32_t midiChanges = 0;
+    uint32_t programRequests = 0;
+};
@@ -10,47 +10,88 @@
 
 #pragma once
 
-inline void protectYourEars(float* buffer, int sampleCount)
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+// How often protectYourEars() had to step in. Only the audio thread adds to
+// them, the UI or a log reads them whenever it likes.
+struct OutputSafetyCounters
+{
+    std::atomic<uint32_t> silenced { 0 }; // buffers muted for NaN, Inf or screaming feedback
+    std::atomic<uint32_t> clamped { 0 }; // buffers with samples clipped to +-1
+};
+
+// |x| as its bit pattern. It orders like the value itself, and NaN and Inf
+// come out above every finite number, so one compare catches them all.
+inline int32_t magnitudeBits(float x)
 {
-    if (buffer == nullptr) { return ; }
-    bool firstWarning = true;
+    int32_t bits;
+    std::memcpy(&bits, &x, sizeof(float));
+    return bits & 0x7FFFFFFF;
+}
+
+// Clips both channels to +-1, or mutes them both if either holds a NaN, an
+// Inf or a sample beyond +-2. The check is a branch-free pass that only
+// reads and vectorizes, the buffers are written only when something is
+// wrong. right may be nullptr.
+inline void protectYourEars(float* left, float* right, int sampleCount, OutputSafetyCounters& counters)
+{
+    if (left == nullptr) { return; }
+
+    const int32_t TWO = 0x40000000; // 2.0f
+    const int32_t ONE = 0x3F800000; // 1.0f
+    int32_t broken = 0;
+    int32_t clipped = 0;
     for (int i = 0; i < sampleCount; ++i) {
-        float x = buffer[i];
-        bool silence = false;
-        if (std::isnan(x)) {
-            DBG("!!!WARNING: nan detected in audio buffer, silencing !!!" );
-            silence = true;
+        int32_t l = magnitudeBits(left[i]);
+        broken |= -int32_t(l > TWO);
+        clipped |= -int32_t(l > ONE);
+    }
+    if (right != nullptr) {
+        for (int i = 0; i < sampleCount; ++i) {
+            int32_t r = magnitudeBits(right[i]);
+            broken |= -int32_t(r > TWO);
+            clipped |= -int32_t(r > ONE);
         }
-        else if (std::isinf(x)) {
-            DBG("!!!WARNING: inf detected in audio buffer, silencing !!!");
-            silence = true;
-        } else if (x < -2.0f || x > 2.0f) { // screaming feedback
-            DBG("!!!WARNING: sample out of range, silencing !!!");
-            silence = true;
+    }
+
+    if (broken != 0) {
+        std::memset(left, 0, size_t(sampleCount) * sizeof(float));
+        if (right != nullptr) {
+            std::memset(right, 0, size_t(sampleCount) * sizeof(float));
         }
-        else if (x < -1.0f) {
-            if (firstWarning) {
-                DBG("!!!WARNING: sample out of range, clamping !!!");
-                firstWarning = false;
-            }
-            buffer[i] = -1.0f;
+        counters.silenced.fetch_add(1, std::memory_order_relaxed);
+    }
+    else if (clipped != 0) {
+        for (int i = 0; i < sampleCount; ++i) {
+            left[i] = std::clamp(left[i], -1.0f, 1.0f);
         }
-        else if (x > 1.0f) {
-            if (firstWarning) {
-                DBG("!!!WARNING: sample out of range, clamping !!!");
-                firstWarning = false;
+        if (right != nullptr) {
+            for (int i = 0; i < sampleCount; ++i) {
+                right[i] = std::clamp(right[i], -1.0f, 1.0f);
             }
-            buffer[i] = 1.0f;
-        }
-        if (silence) {
-            memset(buffer, 0, sampleCount * sizeof(float));
-            return;
         }
+        counters.clamped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// Multiplies the buffer by a straight line from startGain to endGain,
+// reaching endGain on the last sample. Plain loop so it vectorizes.
+inline void applyGainRamp(float* buffer, int sampleCount, float startGain, float endGain)
+{
+    float step = (endGain - startGain) / float(sampleCount);
+    for (int i = 0; i < sampleCount; ++i) {
+        buffer[i] *= startGain + step * float(i + 1);
     }
 }
 
+// Only available to targets that link the plugin's parameter classes
+#if JUCE_MODULE_AVAILABLE_juce_audio_processors
 template<typename T> inline static void castParameter(juce::AudioProcessorValueTreeState& apvts, const juce::ParameterID& id, T& destination)
 {
     destination = dynamic_cast<T>(apvts.getParameter(id.getParamID()));
     jassert(destination); // param does not exist or wrong type
 }
+#endif
@@ -10,100 +10,180 @@
 
 #pragma once
 #include "Oscillator.h"
+#include "PolyBlep.h"
 #include "Envelope.h"
 #include "Filter.h"
 
+// Note and control-rate state of a single voice. The audio-rate state lives
+// in the lane with the same index inside a VoiceGroup.
 struct Voice
 {
-    Oscillator osc1;
-    Oscillator osc2;
-    Envelope env;
-
     int note;
-    float saw;
     float period;
 
-    float panLeft, panRight;
-
     // glide
     float target;
-    float glideRate;
 
     // filter
-    Filter filter;
     float cutoff;
-    float filterMod;
-    float filterQ;
-
-    float pitchBend;
-
-    // filter env
-    Envelope filterEnv;
-    float filterEnvDepth;
 
     void reset()
     {
         note = 0;
-        osc1.reset();
-        osc2.reset();
-        saw = 0.0f;
-        env.reset();
+    }
+};
+
+// Audio-rate state of LANES voices, stored lane by lane so one call to
+// render() runs all voices of the group through the same instructions.
+struct VoiceGroup
+{
+    OscillatorBank osc1;
+    OscillatorBank osc2;
+    EnvelopeBank env;
 
-        panLeft = 0.707f; // - 3dB
-        panRight = 0.707f;
+    // Alternative engine, reads pitch and level from osc1/osc2
+    PolyBlepBank blep1;
+    PolyBlepBank blep2;
 
-        filter.reset();
-        filterEnv.reset();
-    }
+    float saw[LANES];
+    float sawLeak = 0.997f; // integrator leak per sample, set for the voice rate
 
-    void release()
+    float panLeft[LANES], panRight[LANES];
+
+    // filter
+    FilterBank filter;
+
+    // filter env
+    EnvelopeBank filterEnv;
+
+    void reset(int lane)
     {
-        env.release();
-        filterEnv.release();
+        osc1.reset(lane);
+        osc2.reset(lane);
+        blep1.reset(lane);
+        blep2.reset(lane);
+        saw[lane] = 0.0f;
+        env.reset(lane);
+
+        panLeft[lane] = 0.707f; // - 3dB
+        panRight[lane] = 0.707f;
+
+        filter.reset(lane);
+        filterEnv.reset(lane);
     }
 
-    float render(float input)
+    void release(int lane)
     {
-        // advance oscillators
-        float sample1 = osc1.nextSample();
-        float sample2 = osc2.nextSample();
-
-        saw = saw * 0.997f + sample1 - sample2; // apply one-pole LP filter
-
-        // sum input
-        float output = saw + input;
+        env.release(lane);
+        filterEnv.release(lane);
+    }
 
-        // apply filter
-        output = filter.render(output);
+    // Return true if any voice of the group is playing
+    bool isActive() const
+    {
+        for (int i = 0; i < LANES; ++i) {
+            if (env.isActive(i)) { return true; }
+        }
+        return false;
+    }
 
-        // advance envelope
-        float envelope = env.nextValue();
+    // Render a segment of count samples of every voice, without panning.
+    // The output holds LANES values per sample, silent lanes are 0.
+    void renderBlock(const float* input, float* output, int count, bool polyBlep)
+    {
+        if (polyBlep) {
+            for (int sample = 0; sample < count; ++sample) {
+                renderSample<true>(input[sample], output + sample * LANES);
+            }
+        }
+        else {
+            for (int sample = 0; sample < count; ++sample) {
+                renderSample<false>(input[sample], output + sample * LANES);
+            }
+        }
+    }
 
-        // apply envelope
-        return output * envelope;
+    // Pan the output of renderBlock() and add it to left/right
+    void mix(const float* voiceOutput, float* outputLeft, float* outputRight, int count) const
+    {
+        for (int sample = 0; sample < count; ++sample) {
+            const float* output = voiceOutput + sample * LANES;
+            float left = outputLeft[sample];
+            float right = outputRight[sample];
+            for (int i = 0; i < LANES; ++i) {
+                left += output[i] * panLeft[i];
+                right += output[i] * panRight[i];
+            }
+            outputLeft[sample] = left;
+            outputRight[sample] = right;
+        }
     }
 
-    void updatePanning()
+    // spread moves unison sub-voices apart, from -1 to 1
+    void updatePanning(int lane, int note, float spread = 0.0f)
     {
         // Determine panning based on pitch. lower -> left, high -> right
         float panning = std::clamp((note - 60.0f) /
-            24.0f, -1.0f, 1.0f);
+            24.0f + spread, -1.0f, 1.0f);
         // Constant power panning
-        panLeft = std::sin(PI_OVER_4 * (1.0f -
+        panLeft[lane] = std::sin(PI_OVER_4 * (1.0f -
             panning));
-        panRight = std::sin(PI_OVER_4 * (1.0f +
+        panRight[lane] = std::sin(PI_OVER_4 * (1.0f +
             panning));
     }
 
-    void updateLFO()
+private:
+    template<bool polyBlep>
+    void renderSample(float input, float* output)
     {
-        // one pole to reach pitch target
-        period += glideRate * (target - period);
+        LaneMask active[LANES];
+        LaneMask anyActive = 0;
+        for (int i = 0; i < LANES; ++i) {
+            active[i] = laneMask(env.isActive(i));
+            anyActive |= active[i];
+        }
+
+        // Nothing to do once all voices of the group went silent
+        if (anyActive == 0) {
+            std::memset(output, 0, LANES * sizeof(float));
+            return;
+        }
+
+        // advance oscillators
+        float sample1[LANES], sample2[LANES];
+        float voiceOutput[LANES];
+        if constexpr (polyBlep) {
+            // The saws come out directly, no integrator needed
+            blep1.nextSample(active, osc1, sample1);
+            blep2.nextSample(active, osc2, sample2);
+            for (int i = 0; i < LANES; ++i) {
+                voiceOutput[i] = sample1[i] - sample2[i] + input;
+            }
+        }
+        else {
+            osc1.nextSample(active, sample1);
+            osc2.nextSample(active, sample2);
+            for (int i = 0; i < LANES; ++i) {
+                // apply one-pole LP filter
+                float s = saw[i] * sawLeak + sample1[i] - sample2[i];
+                saw[i] = laneSelect(active[i], s, saw[i]);
+                // sum input
+                voiceOutput[i] = s + input;
+            }
+        }
+
+        // apply filter
+        filter.render(active, voiceOutput, voiceOutput);
+
+        // advance envelope
+        float envelope[LANES];
+        env.nextValue(active, envelope);
 
-        float fenv = filterEnv.nextValue();
+        // apply envelope
+        for (int i = 0; i < LANES; ++i) {
+            voiceOutput[i] = laneSelect(active[i], voiceOutput[i] * envelope[i], 0.0f);
+        }
 
-        float modulatedCutoff = cutoff * std::exp(filterMod + filterEnvDepth + fenv) / pitchBend;
-        modulatedCutoff = std::clamp(modulatedCutoff, 30.0f, 20000.0f);
-        filter.updateCoefficients(modulatedCutoff, filterQ);
+        std::memcpy(output, voiceOutput, sizeof(voiceOutput));
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,820 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 17 Oct 2026 2:05:31pm
+    Author:  garam
+
+    Benchmarks for the DSP core. Every result is the average time per
+    sample in nanoseconds (per instance for the startup group), written
+    to the console and optionally to CSV and JSON files so builds can be
+    compared.
+
+    Before timing anything, the FastMath kernels are checked against the
+    double precision functions, and the tool fails if an error is larger
+    than documented in FastMath.h. It also fails if the MIDI coalescer
+    changes what a block sounds like.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "../../../Source/FastMath.h"
+#include "../../../Source/Synth.h"
+#include "../../../Source/MultiTimbralSynth.h"
+#include "../../../Source/SynthParameters.h"
+#include "../../../Source/PluginState.h"
+#include "../../../Source/EventCoalescer.h"
+
+struct Result
+{
+    std::string group;
+    std::string name;
+    int voices;
+    double nsPerSample;
+};
+
+// Keeps the compiler from optimizing away the code under test
+static volatile float sink;
+
+template<typename Function>
+static double timeNanoseconds(int iterations, Function&& function)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        function();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / double(iterations);
+}
+
+// Gives the benchmarks access to the private parts of Synth
+class SynthBenchmark
+{
+public:
+    // One sample of control-rate work, as render() does it
+    static void updateLFO(Synth& synth)
+    {
+        Synth::ControlTick tick;
+        if (synth.updateLFO(tick)) {
+            for (int i = 0; i < synth.numActiveGroups; ++i) {
+                synth.updateVoiceModulation(synth.activeGroups[size_t(i)], tick);
+            }
+        }
+    }
+};
+
+static void allLanesActive(LaneMask* active)
+{
+    for (int i = 0; i < LANES; ++i) {
+        active[i] = laneMask(true);
+    }
+}
+
+static double benchmarkOscillator(float period, int iterations)
+{
+    OscillatorBank osc;
+    for (int i = 0; i < LANES; ++i) {
+        osc.period[i] = period * (1.0f + 0.01f * float(i));
+        osc.amplitude[i] = 0.5f;
+        osc.modulation[i] = 1.0f;
+    }
+    LaneMask active[LANES];
+    allLanesActive(active);
+
+    float output[LANES];
+    return timeNanoseconds(iterations, [&]
+    {
+        osc.nextSample(active, output);
+        sink = output[0];
+    });
+}
+
+static double benchmarkPolyBlep(float period, int iterations)
+{
+    OscillatorBank settings;
+    PolyBlepBank osc;
+    for (int i = 0; i < LANES; ++i) {
+        settings.period[i] = period * (1.0f + 0.01f * float(i));
+        settings.amplitude[i] = 0.5f;
+        settings.modulation[i] = 1.0f;
+    }
+    LaneMask active[LANES];
+    allLanesActive(active);
+
+    float output[LANES];
+    return timeNanoseconds(iterations, [&]
+    {
+        osc.nextSample(active, settings, output);
+        sink = output[0];
+    });
+}
+
+static double benchmarkFilterRender(float sampleRate, int iterations)
+{
+    FilterBank filter;
+    filter.sampleRate = sampleRate;
+    LaneMask active[LANES];
+    allLanesActive(active);
+    float cutoff[LANES];
+    for (int i = 0; i < LANES; ++i) {
+        filter.reset(i);
+        cutoff[i] = 1000.0f + 500.0f * float(i);
+    }
+    filter.updateCoefficients(active, cutoff, 2.0f);
+
+    float input[LANES], output[LANES];
+    for (int i = 0; i < LANES; ++i) {
+        input[i] = (i & 1) ? 0.5f : -0.5f;
+    }
+    return timeNanoseconds(iterations, [&]
+    {
+        filter.render(active, input, output);
+        sink = output[0];
+        // Keep the input moving so the filter states don't settle
+        for (int i = 0; i < LANES; ++i) {
+            input[i] = -input[i];
+        }
+    });
+}
+
+// Coefficient update for every lane, followed by one rendered sample so the
+// new coefficients are actually used
+static double benchmarkFilterCoefficients(float sampleRate, int iterations)
+{
+    FilterBank filter;
+    filter.sampleRate = sampleRate;
+    for (int i = 0; i < LANES; ++i) {
+        filter.reset(i);
+    }
+    LaneMask active[LANES];
+    allLanesActive(active);
+
+    float input[LANES], output[LANES];
+    for (int i = 0; i < LANES; ++i) {
+        input[i] = 0.5f;
+    }
+    float cutoff[LANES];
+    for (int i = 0; i < LANES; ++i) {
+        cutoff[i] = 30.0f + float(i);
+    }
+    return timeNanoseconds(iterations, [&]
+    {
+        filter.updateCoefficients(active, cutoff, 2.0f);
+        filter.render(active, input, output);
+        sink = output[0];
+
+        // Sweep the whole cutoff range so tan() sees realistic inputs
+        for (int i = 0; i < LANES; ++i) {
+            cutoff[i] = (cutoff[i] > 20000.0f) ? 30.0f + float(i) : cutoff[i] * 1.01f;
+        }
+        for (int i = 0; i < LANES; ++i) {
+            input[i] = -input[i];
+        }
+    });
+}
+
+// Inputs spread over the range the synth uses, so both halves of tan() run
+static double benchmarkMath(float (*function)(float), float low, float high, int iterations)
+{
+    float x = low;
+    float step = (high - low) / 1000.0f;
+    return timeNanoseconds(iterations, [&]
+    {
+        sink = function(x);
+        x = (x + step > high) ? low : x + step;
+    });
+}
+
+// Largest error of function relative to reference, over count inputs
+// spread evenly from low to high
+static double maxRelativeError(float (*function)(float), double (*reference)(double),
+                               double low, double high, int count = 1000000)
+{
+    double worst = 0.0;
+    for (int i = 0; i <= count; ++i) {
+        float x = float(low + (high - low) * double(i) / double(count));
+        double expected = reference(double(x));
+        double error = std::abs(double(function(x)) - expected) / std::abs(expected);
+        worst = std::max(worst, error);
+    }
+    return worst;
+}
+
+// Checks the bounds documented in FastMath.h, returns false if one is missed
+static bool checkAccuracy()
+{
+    bool passed = true;
+    auto check = [&](const std::string& name, double error, double bound)
+    {
+        bool ok = error <= bound;
+        passed = passed && ok;
+        std::cout << "accuracy | " << name << " | max relative error " << error
+                  << " (bound " << bound << ")" << (ok ? "" : " FAILED") << "\n";
+    };
+
+    auto exp2 = [](double x) { return std::exp2(x); };
+    auto exp = [](double x) { return std::exp(x); };
+    auto tan = [](double x) { return std::tan(x); };
+
+    check("FastMath::exp2, -126 to 127", maxRelativeError(FastMath::exp2, exp2, -126.0, 127.0), 2e-7);
+    check("FastMath::exp, -10 to 10", maxRelativeError(FastMath::exp, exp, -10.0, 10.0), 1e-6);
+    check("FastMath::exp, -87 to 88", maxRelativeError(FastMath::exp, exp, -87.0, 88.0), 5e-6);
+    check("FastMath::tan, 0 to 1.5", maxRelativeError(FastMath::tan, tan, 1e-4, 1.5), 1e-6);
+
+    // The filter's argument, PI * cutoff / sampleRate, for 30 - 20000 Hz
+    const double pi = 3.1415926535897932;
+    for (double sampleRate : { 44100.0, 48000.0, 96000.0, 192000.0 }) {
+        check("FastMath::tan, 30 - 20000 Hz at " + std::to_string(int(sampleRate)),
+            maxRelativeError(FastMath::tan, tan, pi * 30.0 / sampleRate, pi * 20000.0 / sampleRate),
+            5e-7);
+    }
+    return passed;
+}
+
+static double benchmarkEnvelope(int iterations)
+{
+    EnvelopeBank env;
+    for (int i = 0; i < LANES; ++i) {
+        env.reset(i);
+        env.attackMultiplier[i] = 0.999f;
+        env.decayMultiplier[i] = 0.9999f;
+        env.sustainLevel[i] = 0.5f;
+        env.releaseMultiplier[i] = 0.999f;
+        env.attack(i);
+    }
+    LaneMask active[LANES];
+    allLanesActive(active);
+
+    float output[LANES];
+    return timeNanoseconds(iterations, [&]
+    {
+        env.nextValue(active, output);
+        sink = output[0];
+    });
+}
+
+static double benchmarkNoise(int iterations)
+{
+    NoiseGenerator noise;
+    noise.reset();
+    return timeNanoseconds(iterations, [&]
+    {
+        sink = noise.nextValue();
+    });
+}
+
+// Time per host sample to bring a stereo block down from the oversampled rate
+static double benchmarkOversampler(int factor, int quality, int blockSize, int iterations)
+{
+    Oversampler oversampler;
+    oversampler.allocate(blockSize);
+    oversampler.setup(factor, quality);
+
+    std::vector<float> input(size_t(blockSize * factor));
+    NoiseGenerator noise;
+    noise.reset();
+    for (float& x : input) { x = noise.nextValue(); }
+
+    std::vector<float> left(input.size()), right(input.size());
+    int blocks = std::max(1, iterations / blockSize);
+    double ns = timeNanoseconds(blocks, [&]
+    {
+        std::copy(input.begin(), input.end(), left.begin());
+        std::copy(input.begin(), input.end(), right.begin());
+        oversampler.process(left.data(), right.data(), blockSize);
+        sink = left[0];
+    });
+    return ns / double(blockSize);
+}
+
+// Output safety stage on a stereo block that needs no clipping, the usual case
+static double benchmarkProtectYourEars(int blockSize, int iterations)
+{
+    std::vector<float> left((size_t)blockSize), right((size_t)blockSize);
+    for (int i = 0; i < blockSize; ++i) {
+        left[size_t(i)] = 0.9f * std::sin(0.01f * float(i));
+        right[size_t(i)] = -left[size_t(i)];
+    }
+    OutputSafetyCounters counters;
+    double ns = timeNanoseconds(iterations, [&]
+    {
+        protectYourEars(left.data(), right.data(), blockSize, counters);
+        sink = left[0];
+    });
+    return ns / double(blockSize);
+}
+
+// Startup work of a new instance, in nanoseconds per instance. Every
+// instance used to build its own copy of the factory bank, now they all
+// read the same table, like a host listing the program names does.
+static double benchmarkBankCopy(int iterations)
+{
+    return timeNanoseconds(iterations, [&]
+    {
+        std::vector<Preset> bank;
+        for (const Preset& preset : FACTORY_PRESETS) {
+            bank.emplace_back(preset);
+        }
+        sink = bank.back().param[0];
+    });
+}
+
+static double benchmarkProgramNames(int iterations)
+{
+    return timeNanoseconds(iterations, [&]
+    {
+        size_t length = 0;
+        for (const Preset& preset : FACTORY_PRESETS) {
+            length += std::strlen(preset.name);
+        }
+        sink = float(length);
+    });
+}
+
+static double benchmarkSynthConstruction(int iterations)
+{
+    return timeNanoseconds(iterations, [&]
+    {
+        auto synth = std::make_unique<Synth>();
+        sink = synth->outputLevelSmoother.getTargetValue();
+    });
+}
+
+// Reading the saved state of one instance when a session opens. The XML is
+// what older versions saved; the plug-in also builds a value tree from it,
+// so its real cost is higher still.
+static double benchmarkStateLoadXml(int iterations)
+{
+    juce::XmlElement state("Parameters");
+    for (int i = 0; i < NUM_STATE_PARAMS; ++i) {
+        auto* child = state.createNewChildElement("PARAM");
+        child->setAttribute("id", STATE_PARAMETER_IDS[i]);
+        child->setAttribute("value", 0.5);
+    }
+    const juce::String text = state.toString();
+
+    float values[NUM_STATE_PARAMS] = {};
+    return timeNanoseconds(iterations, [&]
+    {
+        auto xml = juce::parseXML(text);
+        for (auto* child : xml->getChildWithTagNameIterator("PARAM")) {
+            juce::String id = child->getStringAttribute("id");
+            for (int i = 0; i < NUM_STATE_PARAMS; ++i) {
+                if (id == STATE_PARAMETER_IDS[i]) {
+                    values[i] = float(child->getDoubleAttribute("value"));
+                }
+            }
+        }
+        sink = values[0];
+    });
+}
+
+static double benchmarkStateLoadBinary(int iterations)
+{
+    float values[NUM_STATE_PARAMS] = {};
+    PartState parts[NUM_STATE_PARTS] = {};
+    uint8_t data[BINARY_STATE_SIZE];
+    writeBinaryState(values, parts, data);
+    return timeNanoseconds(iterations, [&]
+    {
+        readBinaryState(data, sizeof(data), values, parts);
+        sink = values[0];
+    });
+}
+
+static int renderThreads = 1;
+static int oversampling = 1;
+static int controlRate = 0;
+static bool interpolateFilter = false;
+
+// The synth keeps a pointer to settings, so they must outlive it
+static void preparePreset(Synth& synth, SynthSettings& settings, const Preset& preset,
+                          float sampleRate, int blockSize, int oscEngine = 0, int unison = 1)
+{
+    synth.allocateResources(sampleRate, blockSize);
+    synth.startRenderThreads(renderThreads);
+    settings.controlInterval = controlIntervalFor(controlRate, sampleRate * float(oversampling));
+    settings.interpolateFilter = interpolateFilter;
+    applyParameters(settings, preset.param, sampleRate * float(oversampling));
+    settings.oscEngine = oscEngine;
+    settings.oversampling = oversampling;
+    settings.unisonVoices = unison;
+    settings.unisonGain = 1.0f / std::sqrt(float(unison));
+
+    // Always play polyphonic so the requested number of voices sounds
+    settings.numVoices = Synth::MAX_VOICES;
+    settings.renderThreads = renderThreads;
+
+    synth.setSettings(&settings);
+    synth.reset();
+    synth.outputLevelSmoother.setCurrentAndTargetValue(
+        juce::Decibels::decibelsToGain(preset.param[PARAM_OUTPUT_LEVEL]));
+}
+
+static void noteOn(Synth& synth, int voices)
+{
+    for (int v = 0; v < voices; ++v) {
+        synth.midiMessage(0x90, uint8_t(36 + 5 * v % 60), 100);
+    }
+}
+
+static void noteOff(Synth& synth, int voices)
+{
+    for (int v = 0; v < voices; ++v) {
+        synth.midiMessage(0x80, uint8_t(36 + 5 * v % 60), 0);
+    }
+}
+
+static double benchmarkUpdateLFO(const Preset& preset, float sampleRate, int iterations)
+{
+    SynthSettings settings;
+    Synth synth;
+    preparePreset(synth, settings, preset, sampleRate, 512);
+    noteOn(synth, Synth::MAX_VOICES);
+    return timeNanoseconds(iterations, [&]
+    {
+        SynthBenchmark::updateLFO(synth);
+    });
+}
+
+// Blocks with no voice sounding, after the oversampling filters ran out
+static double benchmarkIdle(const Preset& preset, float sampleRate, int blockSize, int iterations)
+{
+    SynthSettings settings;
+    Synth synth;
+    preparePreset(synth, settings, preset, sampleRate, blockSize);
+
+    std::vector<float> left((size_t)blockSize), right((size_t)blockSize);
+    float* outputBuffers[2] = { left.data(), right.data() };
+    synth.render(outputBuffers, blockSize);
+
+    double ns = timeNanoseconds(iterations, [&]
+    {
+        synth.render(outputBuffers, blockSize);
+        sink = left[0];
+    });
+    return ns / double(blockSize);
+}
+
+// With unison, voices counts the sub-voices, so that many / unison notes play
+static double benchmarkRender(const Preset& preset, int oscEngine, int voices, float sampleRate,
+                              int blockSize, double seconds, int unison = 1)
+{
+    SynthSettings settings;
+    Synth synth;
+    preparePreset(synth, settings, preset, sampleRate, blockSize, oscEngine, unison);
+    voices = juce::jmax(1, voices / unison);
+
+    std::vector<float> left((size_t)blockSize), right((size_t)blockSize);
+    float* outputBuffers[2] = { left.data(), right.data() };
+
+    // Strike the chord again every quarter second, so presets with a short
+    // decay keep the requested number of voices busy
+    const int blocksPerNote = juce::jmax(1, int(0.25f * sampleRate) / blockSize);
+    const int numBlocks = juce::jmax(1, int(seconds * sampleRate) / blockSize);
+
+    // Warm up
+    noteOn(synth, voices);
+    synth.render(outputBuffers, blockSize);
+
+    int block = 0;
+    double ns = timeNanoseconds(numBlocks, [&]
+    {
+        if (++block % blocksPerNote == 0) {
+            noteOff(synth, voices);
+            noteOn(synth, voices);
+        }
+        synth.render(outputBuffers, blockSize);
+        sink = left[0];
+    });
+    return ns / double(blockSize);
+}
+
+// Splits the block at every event like the plug-in does
+static void renderWithEvents(Synth& synth, const MidiEvent* events, int numEvents,
+                             float* left, float* right, int blockSize)
+{
+    int offset = 0;
+    for (int i = 0; i < numEvents; ++i) {
+        const MidiEvent& event = events[i];
+        if (event.position > offset) {
+            float* outputBuffers[2] = { left + offset, right + offset };
+            synth.render(outputBuffers, event.position - offset);
+            offset = event.position;
+        }
+        synth.midiMessage(event.data0, event.data1, event.data2);
+    }
+    if (offset < blockSize) {
+        float* outputBuffers[2] = { left + offset, right + offset };
+        synth.render(outputBuffers, blockSize - offset);
+    }
+}
+
+// The coalescer may only drop messages that a later one overrides. CC 0x4A
+// and 0x4B both set the filter, so when they take turns on one sample the
+// last one has to stay last. Both ways of coalescing have to render the
+// same as the messages as they came in, returns false if one doesn't.
+static bool checkCoalescer(float sampleRate, int blockSize)
+{
+    const int later = juce::jmin(8, blockSize - 1);
+    const std::vector<MidiEvent> input = {
+        { 0, 0x90, 60, 100 },
+        { 0, 0xB0, 0x4A, 10 }, { 0, 0xB0, 0x4B, 100 }, { 0, 0xB0, 0x4A, 40 },
+        { later, 0xB0, 0x4B, 20 }, { later, 0xB0, 0x4A, 90 }, { later, 0xB0, 0x4B, 70 },
+    };
+
+    auto renderEvents = [&](const std::vector<MidiEvent>& events)
+    {
+        SynthSettings settings;
+        Synth synth;
+        preparePreset(synth, settings, FACTORY_PRESETS[0], sampleRate, blockSize);
+        std::vector<float> left((size_t)blockSize), right((size_t)blockSize);
+        renderWithEvents(synth, events.data(), int(events.size()), left.data(), right.data(), blockSize);
+        return left;
+    };
+
+    auto coalescer = std::make_unique<EventCoalescer>();
+    std::vector<MidiEvent> processed = input;
+    processed.resize(size_t(coalescer->process(processed.data(), int(processed.size()), 1)));
+
+    std::vector<MidiEvent> added(input.size());
+    EventCoalescer::Queue queue { added.data(), int(added.size()) };
+    for (const MidiEvent& event : input) {
+        coalescer->add(queue, event, 1);
+    }
+    added.resize(size_t(queue.numEvents));
+
+    bool passed = true;
+    const std::vector<float> expected = renderEvents(input);
+    auto check = [&](const std::string& name, const std::vector<MidiEvent>& events)
+    {
+        bool ok = events.size() < input.size() && renderEvents(events) == expected;
+        passed = passed && ok;
+        std::cout << "coalescer | " << name << ", CC 0x4A and 0x4B on one sample | "
+                  << events.size() << " of " << input.size() << " messages" << (ok ? "" : " FAILED") << "\n";
+    };
+    check("EventCoalescer::process", processed);
+    check("EventCoalescer::add", added);
+    return passed;
+}
+
+// A chord with a controller sweep on top: every block brings pitch bend and
+// mod wheel messages, either all on the first sample or spread over the
+// block. The block is split at every event like the plug-in does, after the
+// coalescer if gridSize isn't 0.
+static double benchmarkControllerFlood(const Preset& preset, int voices, int eventsPerBlock, bool spread,
+                                       int gridSize, float sampleRate, int blockSize, double seconds)
+{
+    SynthSettings settings;
+    Synth synth;
+    preparePreset(synth, settings, preset, sampleRate, blockSize);
+
+    std::vector<float> left((size_t)blockSize), right((size_t)blockSize);
+    std::vector<MidiEvent> events((size_t)eventsPerBlock);
+    EventCoalescer coalescer;
+    const int numBlocks = juce::jmax(1, int(seconds * sampleRate) / blockSize);
+
+    noteOn(synth, voices);
+    int block = 0;
+    double ns = timeNanoseconds(numBlocks, [&]
+    {
+        ++block;
+        for (int i = 0; i < eventsPerBlock; ++i) {
+            int position = spread ? i * blockSize / eventsPerBlock : 0;
+            uint8_t value = uint8_t((block + i) & 0x7F);
+            events[size_t(i)] = (i % 2 == 0) ? MidiEvent { position, 0xE0, 0, value }
+                                             : MidiEvent { position, 0xB0, 0x01, value };
+        }
+        int numEvents = eventsPerBlock;
+        if (gridSize > 0) {
+            numEvents = coalescer.process(events.data(), numEvents, gridSize);
+        }
+
+        renderWithEvents(synth, events.data(), numEvents, left.data(), right.data(), blockSize);
+        sink = left[0];
+    });
+    return ns / double(blockSize);
+}
+
+// Every part plays a different preset, the parts are shared out over
+// --threads threads
+static double benchmarkMultiTimbral(int voicesPerPart,
+                                    float sampleRate, int blockSize, double seconds)
+{
+    const int numParts = MultiTimbralSynth::NUM_PARTS;
+    SynthSettings settings[numParts];
+    MultiTimbralSynth synth;
+    synth.allocateResources(sampleRate, blockSize);
+    synth.startRenderThreads(renderThreads);
+    for (int part = 0; part < numParts; ++part) {
+        SynthSettings& partSettings = settings[part];
+        partSettings.controlInterval = controlIntervalFor(controlRate, sampleRate * float(oversampling));
+        partSettings.interpolateFilter = interpolateFilter;
+        applyParameters(partSettings, FACTORY_PRESETS[part % NUM_FACTORY_PRESETS].param, sampleRate * float(oversampling));
+        partSettings.oversampling = oversampling;
+        partSettings.numVoices = Synth::MAX_VOICES;
+        synth.setSettings(part, &partSettings);
+    }
+    synth.reset();
+
+    std::vector<float> left((size_t)blockSize), right((size_t)blockSize);
+    float* outputBuffers[2] = { left.data(), right.data() };
+
+    auto strike = [&](uint8_t status)
+    {
+        for (int part = 0; part < numParts; ++part) {
+            for (int v = 0; v < voicesPerPart; ++v) {
+                synth.addEvent(0, uint8_t(status | part), uint8_t(36 + 5 * v % 60), 100);
+            }
+        }
+    };
+
+    const int blocksPerNote = juce::jmax(1, int(0.25f * sampleRate) / blockSize);
+    const int numBlocks = juce::jmax(1, int(seconds * sampleRate) / blockSize);
+
+    // Warm up
+    strike(0x90);
+    synth.render(outputBuffers, blockSize, renderThreads);
+
+    int block = 0;
+    double ns = timeNanoseconds(numBlocks, [&]
+    {
+        if (++block % blocksPerNote == 0) {
+            strike(0x80);
+            strike(0x90);
+        }
+        synth.render(outputBuffers, blockSize, renderThreads);
+        sink = left[0];
+    });
+    return ns / double(blockSize);
+}
+
+static std::string escapeJSON(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') { escaped += '\\'; }
+        escaped += c;
+    }
+    return escaped;
+}
+
+static void writeCSV(const std::string& path, const std::vector<Result>& results)
+{
+    std::ofstream file(path);
+    file << "group,name,voices,ns_per_sample\n";
+    for (const auto& r : results) {
+        file << r.group << ",\"" << r.name << "\"," << r.voices << "," << r.nsPerSample << "\n";
+    }
+}
+
+static void writeJSON(const std::string& path, const std::vector<Result>& results)
+{
+    std::ofstream file(path);
+    file << "[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        file << "  { \"group\": \"" << r.group << "\", \"name\": \"" << escapeJSON(r.name)
+             << "\", \"voices\": " << r.voices << ", \"ns_per_sample\": " << r.nsPerSample
+             << (i + 1 < results.size() ? " },\n" : " }\n");
+    }
+    file << "]\n";
+}
+
+int main(int argc, char* argv[])
+{
+    float sampleRate = 48000.0f;
+    int blockSize = 512;
+    double seconds = 2.0;
+    std::string csvPath, jsonPath;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--rate" && hasValue) { sampleRate = std::stof(argv[++i]); }
+        else if (arg == "--block" && hasValue) { blockSize = std::stoi(argv[++i]); }
+        else if (arg == "--threads" && hasValue) { renderThreads = std::stoi(argv[++i]); }
+        else if (arg == "--oversampling" && hasValue) { oversampling = std::stoi(argv[++i]); }
+        else if (arg == "--control" && hasValue) { controlRate = std::stoi(argv[++i]); }
+        else if (arg == "--interpolate") { interpolateFilter = true; }
+        else if (arg == "--seconds" && hasValue) { seconds = std::stod(argv[++i]); }
+        else if (arg == "--csv" && hasValue) { csvPath = argv[++i]; }
+        else if (arg == "--json" && hasValue) { jsonPath = argv[++i]; }
+        else {
+            std::cout << "Usage: JX11Bench [--rate HZ] [--block N] [--threads N] [--oversampling 1|2|4]"
+                         " [--control N] [--interpolate] [--seconds S per preset] [--csv FILE] [--json FILE]\n";
+            return 1;
+        }
+    }
+
+    if (oversampling != 1 && oversampling != 2 && oversampling != 4) {
+        std::cout << "--oversampling must be 1, 2 or 4\n";
+        return 1;
+    }
+    if (controlRate < 0 || controlRate >= NUM_CONTROL_RATES) {
+        std::cout << "--control must be 0 to " << NUM_CONTROL_RATES - 1 << "\n";
+        return 1;
+    }
+
+    juce::ScopedNoDenormals noDenormals;
+
+    if (!checkAccuracy()) { return 1; }
+    if (!checkCoalescer(sampleRate, blockSize)) { return 1; }
+
+    std::vector<Result> results;
+    auto report = [&](const std::string& group, const std::string& name, int voices, double ns)
+    {
+        results.push_back({ group, name, voices, ns });
+        std::cout << group << " | " << name << " | " << voices << " voices | "
+                  << ns << (group == "startup" ? " ns/instance\n" : " ns/sample\n");
+    };
+
+    // Micro benchmarks: one call processes all LANES voices
+    const int iterations = int(seconds * sampleRate);
+    report("micro", "OscillatorBank::nextSample (period 400)", LANES, benchmarkOscillator(400.0f, iterations));
+    report("micro", "OscillatorBank::nextSample (period 12, restart branch)", LANES, benchmarkOscillator(12.0f, iterations));
+    report("micro", "PolyBlepBank::nextSample (period 400)", LANES, benchmarkPolyBlep(400.0f, iterations));
+    report("micro", "PolyBlepBank::nextSample (period 12)", LANES, benchmarkPolyBlep(12.0f, iterations));
+    report("micro", "FilterBank::render", LANES, benchmarkFilterRender(sampleRate, iterations));
+    report("micro", "FilterBank::updateCoefficients + render", LANES, benchmarkFilterCoefficients(sampleRate, iterations));
+    report("micro", "EnvelopeBank::nextValue", LANES, benchmarkEnvelope(iterations));
+    report("micro", "NoiseGenerator::nextValue", 1, benchmarkNoise(iterations));
+    report("micro", "FastMath::tan", 1, benchmarkMath(FastMath::tan, 0.002f, 1.42f, iterations));
+    report("micro", "std::tan", 1, benchmarkMath(std::tan, 0.002f, 1.42f, iterations));
+    report("micro", "FastMath::exp", 1, benchmarkMath(FastMath::exp, -10.0f, 10.0f, iterations));
+    report("micro", "std::exp", 1, benchmarkMath(std::exp, -10.0f, 10.0f, iterations));
+    report("micro", "Synth::updateLFO", Synth::MAX_VOICES, benchmarkUpdateLFO(FACTORY_PRESETS[0], sampleRate, iterations));
+    report("micro", "Oversampler::process 2x Normal", 1, benchmarkOversampler(2, 0, blockSize, iterations));
+    report("micro", "Oversampler::process 2x High", 1, benchmarkOversampler(2, 1, blockSize, iterations));
+    report("micro", "Oversampler::process 4x Normal", 1, benchmarkOversampler(4, 0, blockSize, iterations));
+    report("micro", "Oversampler::process 4x High", 1, benchmarkOversampler(4, 1, blockSize, iterations));
+    report("micro", "protectYourEars stereo, per sample", 0, benchmarkProtectYourEars(blockSize, iterations / blockSize));
+    report("micro", "Synth::render idle, per sample", 0, benchmarkIdle(FACTORY_PRESETS[0], sampleRate, blockSize, iterations / blockSize));
+
+    // Per instance rather than per sample
+    const int instances = std::max(1, iterations / 1000);
+    report("startup", "factory bank copied into a vector (old)", 0, benchmarkBankCopy(instances));
+    report("startup", "program names from the shared table", 0, benchmarkProgramNames(instances));
+    report("startup", "Synth constructor", 0, benchmarkSynthConstruction(instances));
+    report("startup", "state load, XML (old)", 0, benchmarkStateLoadXml(instances));
+    report("startup", "state load, binary", 0, benchmarkStateLoadBinary(instances));
+
+    // Macro benchmarks: every factory preset at several voice counts, with
+    // the BLIT and again with the PolyBLEP oscillators
+    std::vector<int> voiceCounts;
+    for (int voices : { 1, 4, 8, 32, Synth::MAX_VOICES }) {
+        if (voices <= Synth::MAX_VOICES && (voiceCounts.empty() || voices > voiceCounts.back())) {
+            voiceCounts.push_back(voices);
+        }
+    }
+
+    for (const Preset& preset : FACTORY_PRESETS) {
+        for (int voices : voiceCounts) {
+            report("render", preset.name, voices,
+                benchmarkRender(preset, 0, voices, sampleRate, blockSize, seconds));
+            report("render-polyblep", preset.name, voices,
+                benchmarkRender(preset, 1, voices, sampleRate, blockSize, seconds));
+        }
+    }
+
+    // Every note stacked 8 deep, same number of voices as above
+    for (int voices : voiceCounts) {
+        if (voices >= 8) {
+            report("render-unison-8", FACTORY_PRESETS[0].name, voices,
+                benchmarkRender(FACTORY_PRESETS[0], 0, voices, sampleRate, blockSize, seconds, 8));
+        }
+    }
+
+    // Render cost with a controller flood, without the coalescer, with it,
+    // and with it on a 32 sample grid
+    const int floodEvents = juce::jmin(256, blockSize);
+    report("controller-flood", "no MIDI", 8,
+        benchmarkControllerFlood(FACTORY_PRESETS[0], 8, 0, false, 0, sampleRate, blockSize, seconds));
+    for (bool spread : { false, true }) {
+        std::string where = spread ? ", spread" : ", one sample";
+        report("controller-flood", std::to_string(floodEvents) + " per block" + where, 8,
+            benchmarkControllerFlood(FACTORY_PRESETS[0], 8, floodEvents, spread, 0, sampleRate, blockSize, seconds));
+        report("controller-flood", std::to_string(floodEvents) + " per block" + where + ", coalesced", 8,
+            benchmarkControllerFlood(FACTORY_PRESETS[0], 8, floodEvents, spread, 1, sampleRate, blockSize, seconds));
+        report("controller-flood", std::to_string(floodEvents) + " per block" + where + ", grid 32", 8,
+            benchmarkControllerFlood(FACTORY_PRESETS[0], 8, floodEvents, spread, 32, sampleRate, blockSize, seconds));
+    }
+
+    // One instance playing on all channels at once
+    for (int voicesPerPart : { 1, 8 }) {
+        report("multi-timbral", std::to_string(MultiTimbralSynth::NUM_PARTS) + " parts",
+            MultiTimbralSynth::NUM_PARTS * voicesPerPart,
+            benchmarkMultiTimbral(voicesPerPart, sampleRate, blockSize, seconds));
+    }
+
+    if (!csvPath.empty()) { writeCSV(csvPath, results); }
+    if (!jsonPath.empty()) { writeJSON(jsonPath, results); }
+    return 0;
+}
@@ -0,0 +1,506 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 18 Oct 2026 9:14:52am
+    Author:  garam
+
+    Golden output check: plays a fixed MIDI phrase through every factory
+    preset at 44.1, 48 and 96 kHz and compares the result with reference
+    renders made by a build that is known to sound right. The noise
+    generator always starts from the same seed, so the same build renders
+    the same samples every time.
+
+    Run it with --write on the known good build, then without it after
+    every change. A render fails when its peak or RMS error, or the level
+    of an octave band, is off by more than the limits. The failures get a
+    spectrum of the difference so it's clear where the change is heard.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include "../../../Source/Synth.h"
+#include "../../../Source/SynthParameters.h"
+
+static const double SAMPLE_RATES[] = { 44100.0, 48000.0, 96000.0 };
+static const int BLOCK_SIZE = 256;
+
+// The phrase ends at 3 seconds, the rest of the render is the release tail
+static const double RENDER_SECONDS = 4.5;
+
+// Spectrum of 4096 sample frames with half overlap, summed into octave bands
+static const int FFT_ORDER = 12;
+static const int NUM_BANDS = 11; // 31.25 Hz to 32 kHz, cut off at Nyquist
+static const double LOWEST_BAND = 31.25;
+
+// Bands this far below the loudest band of the reference are left out of
+// the comparison, rounding alone moves their level
+static const double BAND_RANGE_DB = 80.0;
+
+struct PhraseEvent
+{
+    double time; // seconds
+    uint8_t data0, data1, data2;
+};
+
+// Plays the parts of a patch that the factory presets differ in: a chord
+// for the polyphony and the mono presets' note priority, a legato line for
+// the glide, mod wheel and pitch bend sweeps, notes released while the
+// sustain pedal is down, and the extremes of the keyboard and velocity.
+static std::vector<PhraseEvent> makePhrase()
+{
+    std::vector<PhraseEvent> phrase;
+    auto note = [&](double start, double end, uint8_t key, uint8_t velocity)
+    {
+        phrase.push_back({ start, 0x90, key, velocity });
+        phrase.push_back({ end, 0x80, key, 0 });
+    };
+
+    note(0.00, 1.00, 48, 100);
+    note(0.25, 1.00, 55, 80);
+    note(0.50, 1.00, 60, 127);
+
+    // Mod wheel up and back over the chord, then a bend up and back
+    for (int i = 0; i <= 32; ++i) {
+        double t = double(i) / 32.0;
+        phrase.push_back({ 0.50 + 0.25 * t, 0xB0, 0x01, uint8_t(127.0 * t + 0.5) });
+        phrase.push_back({ 0.75 + 0.25 * t, 0xB0, 0x01, uint8_t(127.0 * (1.0 - t) + 0.5) });
+    }
+    for (int i = 0; i <= 32; ++i) {
+        int bend = 8192 + int(4096.0 * std::sin(juce::MathConstants<double>::pi * double(i) / 32.0));
+        phrase.push_back({ 0.60 + 0.30 * double(i) / 32.0, 0xE0, uint8_t(bend & 0x7F), uint8_t(bend >> 7) });
+    }
+
+    // Overlapping notes glide in the mono presets
+    note(1.10, 1.45, 64, 64);
+    note(1.40, 1.75, 67, 64);
+    note(1.70, 1.95, 62, 64);
+
+    // Released while the pedal holds them
+    phrase.push_back({ 2.00, 0xB0, 0x40, 127 });
+    note(2.05, 2.15, 72, 90);
+    note(2.15, 2.25, 76, 90);
+    phrase.push_back({ 2.40, 0xB0, 0x40, 0 });
+
+    note(2.50, 3.00, 96, 30);
+    note(2.50, 3.00, 24, 127);
+
+    // Stable, so notes on the same sample keep the order above
+    std::stable_sort(phrase.begin(), phrase.end(), [](const PhraseEvent& a, const PhraseEvent& b)
+    {
+        return a.time < b.time;
+    });
+    return phrase;
+}
+
+// Same as JX11AudioProcessor::reset()
+static void resetSynth(Synth& synth, const float* param)
+{
+    synth.reset();
+    synth.outputLevelSmoother.setCurrentAndTargetValue(
+        juce::Decibels::decibelsToGain(param[PARAM_OUTPUT_LEVEL]));
+}
+
+// Renders the phrase the way JX11Render plays a MIDI file
+static juce::AudioBuffer<float> renderPreset(int presetIndex, double sampleRate, int renderThreads,
+                                             const std::vector<PhraseEvent>& phrase)
+{
+    const float* param = FACTORY_PRESETS[presetIndex].param;
+
+    Synth synth;
+    synth.allocateResources(sampleRate, BLOCK_SIZE);
+    synth.startRenderThreads(renderThreads);
+
+    SynthSettings settings;
+    settings.renderThreads = renderThreads;
+    settings.controlInterval = controlIntervalFor(0, float(sampleRate));
+    applyParameters(settings, param, float(sampleRate));
+    synth.setSettings(&settings);
+    resetSynth(synth, param);
+
+    const int totalSamples = int(RENDER_SECONDS * sampleRate);
+    juce::AudioBuffer<float> output(2, totalSamples);
+    output.clear();
+
+    size_t nextEvent = 0;
+    for (int blockStart = 0; blockStart < totalSamples; blockStart += BLOCK_SIZE) {
+        int blockEnd = juce::jmin(blockStart + BLOCK_SIZE, totalSamples);
+        int position = blockStart;
+
+        auto render = [&](int end)
+        {
+            float* outputBuffers[2] = {
+                output.getWritePointer(0) + position,
+                output.getWritePointer(1) + position,
+            };
+            synth.render(outputBuffers, end - position);
+            position = end;
+        };
+
+        while (nextEvent < phrase.size()) {
+            const PhraseEvent& event = phrase[nextEvent];
+            int eventPosition = int(std::llround(event.time * sampleRate));
+            if (eventPosition >= blockEnd) { break; }
+
+            if (eventPosition > position) {
+                render(eventPosition);
+            }
+            synth.midiMessage(event.data0, event.data1, event.data2);
+            ++nextEvent;
+        }
+
+        if (blockEnd > position) {
+            render(blockEnd);
+        }
+    }
+    return output;
+}
+
+static juce::File referenceFile(const juce::File& directory, int presetIndex, double sampleRate)
+{
+    return directory.getChildFile(juce::String::formatted("%02d_%d.wav", presetIndex, int(sampleRate)));
+}
+
+// 32 bit WAV files are floats, so the samples come back exactly
+static bool writeWav(const juce::File& file, const juce::AudioBuffer<float>& buffer, double sampleRate)
+{
+    file.deleteFile();
+    auto stream = std::make_unique<juce::FileOutputStream>(file);
+    if (!stream->openedOk()) { return false; }
+
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wavFormat.createWriterFor(
+        stream.get(), sampleRate, juce::uint32(buffer.getNumChannels()), 32, {}, 0));
+    if (writer == nullptr) { return false; }
+    stream.release(); // the writer owns the stream now
+
+    return writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+}
+
+static bool readWav(const juce::File& file, juce::AudioBuffer<float>& buffer, double sampleRate)
+{
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatReader> reader(wavFormat.createReaderFor(
+        new juce::FileInputStream(file), true));
+    if (reader == nullptr || reader->sampleRate != sampleRate || reader->numChannels != 2) { return false; }
+
+    buffer.setSize(2, int(reader->lengthInSamples));
+    return reader->read(&buffer, 0, int(reader->lengthInSamples), 0, true, true);
+}
+
+static double toDecibels(double power)
+{
+    return (power > 0.0) ? 10.0 * std::log10(power) : -999.0;
+}
+
+// Power per octave band, averaged over the frames and summed over both
+// channels. A full scale sine reads about 0 dB.
+struct Spectrum
+{
+    double band[NUM_BANDS] = {};
+};
+
+class SpectrumAnalyzer
+{
+public:
+    SpectrumAnalyzer()
+        : fft(FFT_ORDER),
+          window(size_t(FFT_SIZE), juce::dsp::WindowingFunction<float>::hann, false),
+          frame(size_t(FFT_SIZE * 2))
+    {
+        // A Hann window halves a sine's amplitude
+        scale = 4.0 / double(FFT_SIZE);
+    }
+
+    // With a reference, analyzes signal minus reference instead
+    Spectrum analyze(const juce::AudioBuffer<float>& signal, double sampleRate,
+                     const juce::AudioBuffer<float>* reference = nullptr)
+    {
+        Spectrum spectrum;
+        const int numSamples = signal.getNumSamples();
+        int numFrames = 0;
+        for (int start = 0; start + FFT_SIZE <= numSamples; start += FFT_SIZE / 2) {
+            for (int channel = 0; channel < signal.getNumChannels(); ++channel) {
+                const float* samples = signal.getReadPointer(channel) + start;
+                const float* subtract = (reference != nullptr) ? reference->getReadPointer(channel) + start : nullptr;
+                std::fill(frame.begin(), frame.end(), 0.0f);
+                for (int i = 0; i < FFT_SIZE; ++i) {
+                    frame[size_t(i)] = samples[i] - ((subtract != nullptr) ? subtract[i] : 0.0f);
+                }
+                window.multiplyWithWindowingTable(frame.data(), size_t(FFT_SIZE));
+                fft.performFrequencyOnlyForwardTransform(frame.data());
+
+                // Skip DC, the bins go into the band they're in
+                for (int bin = 1; bin <= FFT_SIZE / 2; ++bin) {
+                    double frequency = double(bin) * sampleRate / double(FFT_SIZE);
+                    int band = bandOf(frequency);
+                    if (band < 0) { continue; }
+                    double magnitude = double(frame[size_t(bin)]) * scale;
+                    spectrum.band[band] += magnitude * magnitude;
+                }
+            }
+            ++numFrames;
+        }
+
+        for (double& power : spectrum.band) {
+            power /= double(juce::jmax(numFrames, 1));
+        }
+        return spectrum;
+    }
+
+    // Bands are an octave wide, centered on LOWEST_BAND times a power of two
+    static double bandCenter(int band)
+    {
+        return LOWEST_BAND * std::pow(2.0, double(band));
+    }
+
+    static int bandOf(double frequency)
+    {
+        int band = int(std::floor(std::log2(frequency / LOWEST_BAND) + 0.5));
+        return (band >= 0 && band < NUM_BANDS) ? band : -1;
+    }
+
+private:
+    static constexpr int FFT_SIZE = 1 << FFT_ORDER;
+
+    juce::dsp::FFT fft;
+    juce::dsp::WindowingFunction<float> window;
+    std::vector<float> frame;
+    double scale;
+};
+
+struct Limits
+{
+    bool exact = false; // any difference fails
+    double peak = -96.0; // dBFS
+    double rms = -80.0; // dB relative to the reference
+    double band = 0.1; // dB change in any octave band
+};
+
+struct Comparison
+{
+    bool identical = true;
+    double peakError = -999.0, rmsError = -999.0, bandChange = 0.0;
+    Spectrum reference, render, error;
+};
+
+static Comparison compare(const juce::AudioBuffer<float>& reference, const juce::AudioBuffer<float>& render,
+                          double sampleRate, SpectrumAnalyzer& analyzer)
+{
+    Comparison result;
+    double peak = 0.0, errorPower = 0.0, referencePower = 0.0;
+    for (int channel = 0; channel < 2; ++channel) {
+        const float* a = reference.getReadPointer(channel);
+        const float* b = render.getReadPointer(channel);
+        for (int i = 0; i < reference.getNumSamples(); ++i) {
+            double difference = double(b[i]) - double(a[i]);
+            peak = std::max(peak, std::abs(difference));
+            errorPower += difference * difference;
+            referencePower += double(a[i]) * double(a[i]);
+        }
+    }
+    if (peak == 0.0) { return result; }
+
+    result.identical = false;
+    result.peakError = toDecibels(peak * peak);
+    result.rmsError = (referencePower > 0.0) ? toDecibels(errorPower / referencePower) : 999.0;
+
+    result.reference = analyzer.analyze(reference, sampleRate);
+    result.render = analyzer.analyze(render, sampleRate);
+    result.error = analyzer.analyze(render, sampleRate, &reference);
+    double loudest = *std::max_element(result.reference.band, result.reference.band + NUM_BANDS);
+    double floor = toDecibels(loudest) - BAND_RANGE_DB;
+    for (int band = 0; band < NUM_BANDS; ++band) {
+        double before = toDecibels(result.reference.band[band]);
+        double after = toDecibels(result.render.band[band]);
+        if (before > floor || after > floor) {
+            result.bandChange = std::max(result.bandChange, std::abs(after - before));
+        }
+    }
+    return result;
+}
+
+static bool passes(const Comparison& result, const Limits& limits)
+{
+    if (result.identical) { return true; }
+    if (limits.exact) { return false; }
+    return result.peakError <= limits.peak && result.rmsError <= limits.rms && result.bandChange <= limits.band;
+}
+
+// One line per octave band: the levels of both renders and of their
+// difference, which shows where the change is
+static void printSpectrum(const Comparison& result, double sampleRate)
+{
+    std::cout << "      band Hz   reference     render     change   difference\n";
+    for (int band = 0; band < NUM_BANDS; ++band) {
+        double center = SpectrumAnalyzer::bandCenter(band);
+        if (center / std::sqrt(2.0) >= sampleRate * 0.5) { break; }
+
+        double before = toDecibels(result.reference.band[band]);
+        double after = toDecibels(result.render.band[band]);
+        double difference = toDecibels(result.error.band[band]);
+        std::cout << juce::String::formatted("    %8.0f  %8.1f dB %8.1f dB %+8.2f dB %8.1f dB\n",
+                                             center, before, after, after - before, difference);
+    }
+}
+
+static void printUsage()
+{
+    std::cout << "Usage: JX11Golden [options] directory\n"
+                 "  --write        render the references into the directory\n"
+                 "  --preset N     only this factory preset (default all)\n"
+                 "  --rate HZ      only this sample rate: 44100, 48000 or 96000 (default all)\n"
+                 "  --threads N    threads that render the voices (default 1)\n"
+                 "  --exact        fail on any difference\n"
+                 "  --peak DB      largest peak error, in dBFS (default -96)\n"
+                 "  --rms DB       largest RMS error, relative to the reference (default -80)\n"
+                 "  --band DB      largest level change in an octave band (default 0.1)\n"
+                 "  --verbose      print the spectrum of every render that differs\n"
+                 "  --csv FILE     write the octave bands of every render that differs\n"
+                 "  --failed DIR   write the renders that fail, to listen to them\n";
+}
+
+int main(int argc, char* argv[])
+{
+    bool write = false;
+    int onlyPreset = -1;
+    double onlyRate = 0.0;
+    int renderThreads = 1;
+    Limits limits;
+    bool verbose = false;
+    juce::File csvFile, failedDirectory;
+    juce::StringArray directories;
+
+    for (int i = 1; i < argc; ++i) {
+        juce::String arg(argv[i]);
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--write") { write = true; }
+        else if (arg == "--preset" && hasValue) { onlyPreset = juce::String(argv[++i]).getIntValue(); }
+        else if (arg == "--rate" && hasValue) { onlyRate = juce::String(argv[++i]).getDoubleValue(); }
+        else if (arg == "--threads" && hasValue) { renderThreads = juce::String(argv[++i]).getIntValue(); }
+        else if (arg == "--exact") { limits.exact = true; }
+        else if (arg == "--peak" && hasValue) { limits.peak = juce::String(argv[++i]).getDoubleValue(); }
+        else if (arg == "--rms" && hasValue) { limits.rms = juce::String(argv[++i]).getDoubleValue(); }
+        else if (arg == "--band" && hasValue) { limits.band = juce::String(argv[++i]).getDoubleValue(); }
+        else if (arg == "--verbose") { verbose = true; }
+        else if (arg == "--csv" && hasValue) { csvFile = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]); }
+        else if (arg == "--failed" && hasValue) { failedDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]); }
+        else if (arg.startsWith("--")) { printUsage(); return 1; }
+        else { directories.add(arg); }
+    }
+
+    bool knownRate = (onlyRate == 0.0);
+    for (double rate : SAMPLE_RATES) {
+        knownRate = knownRate || (rate == onlyRate);
+    }
+    if (directories.size() != 1 || !knownRate || renderThreads < 1
+        || onlyPreset < -1 || onlyPreset >= NUM_FACTORY_PRESETS) {
+        printUsage();
+        return 1;
+    }
+
+    auto directory = juce::File::getCurrentWorkingDirectory().getChildFile(directories[0]);
+    if (write && !directory.createDirectory()) {
+        std::cerr << "Could not create " << directory.getFullPathName() << "\n";
+        return 1;
+    }
+    if (failedDirectory != juce::File() && !failedDirectory.createDirectory()) {
+        std::cerr << "Could not create " << failedDirectory.getFullPathName() << "\n";
+        return 1;
+    }
+
+    std::ofstream csv;
+    if (csvFile != juce::File()) {
+        csv.open(csvFile.getFullPathName().toStdString());
+        if (!csv) {
+            std::cerr << "Could not create " << csvFile.getFullPathName() << "\n";
+            return 1;
+        }
+        csv << "preset,name,rate,band_hz,reference_db,render_db,change_db,difference_db\n";
+    }
+
+    juce::ScopedNoDenormals noDenormals;
+
+    const std::vector<PhraseEvent> phrase = makePhrase();
+    SpectrumAnalyzer analyzer;
+    int numRenders = 0, numIdentical = 0, numFailed = 0;
+
+    for (int presetIndex = 0; presetIndex < NUM_FACTORY_PRESETS; ++presetIndex) {
+        if (onlyPreset >= 0 && presetIndex != onlyPreset) { continue; }
+        for (double sampleRate : SAMPLE_RATES) {
+            if (onlyRate != 0.0 && sampleRate != onlyRate) { continue; }
+            ++numRenders;
+
+            juce::String name = juce::String::formatted("%2d %-24s %5d Hz", presetIndex,
+                                                        FACTORY_PRESETS[presetIndex].name, int(sampleRate));
+            juce::AudioBuffer<float> render = renderPreset(presetIndex, sampleRate, renderThreads, phrase);
+            juce::File file = referenceFile(directory, presetIndex, sampleRate);
+
+            if (write) {
+                if (!writeWav(file, render, sampleRate)) {
+                    std::cerr << "Could not write " << file.getFullPathName() << "\n";
+                    return 1;
+                }
+                std::cout << name << "  written\n";
+                continue;
+            }
+
+            juce::AudioBuffer<float> reference;
+            if (!file.existsAsFile() || !readWav(file, reference, sampleRate)) {
+                std::cout << name << "  FAILED, no reference " << file.getFileName() << "\n";
+                ++numFailed;
+                continue;
+            }
+            if (reference.getNumSamples() != render.getNumSamples()) {
+                std::cout << name << "  FAILED, the reference is " << reference.getNumSamples()
+                          << " samples long, the render " << render.getNumSamples() << "\n";
+                ++numFailed;
+                continue;
+            }
+
+            Comparison result = compare(reference, render, sampleRate, analyzer);
+            bool ok = passes(result, limits);
+            if (result.identical) {
+                std::cout << name << "  identical\n";
+                ++numIdentical;
+                continue;
+            }
+
+            std::cout << name << juce::String::formatted("  peak %7.1f dB  rms %7.1f dB  band %5.2f dB  ",
+                                                         result.peakError, result.rmsError, result.bandChange)
+                      << (ok ? "ok" : "FAILED") << "\n";
+            if (!ok || verbose) {
+                printSpectrum(result, sampleRate);
+            }
+            if (!ok) {
+                ++numFailed;
+                if (failedDirectory != juce::File()) {
+                    writeWav(referenceFile(failedDirectory, presetIndex, sampleRate), render, sampleRate);
+                }
+            }
+
+            if (csv.is_open()) {
+                for (int band = 0; band < NUM_BANDS; ++band) {
+                    double before = toDecibels(result.reference.band[band]);
+                    double after = toDecibels(result.render.band[band]);
+                    csv << presetIndex << ",\"" << FACTORY_PRESETS[presetIndex].name << "\"," << sampleRate << ","
+                        << SpectrumAnalyzer::bandCenter(band) << "," << before << "," << after << ","
+                        << (after - before) << "," << toDecibels(result.error.band[band]) << "\n";
+                }
+            }
+        }
+    }
+
+    if (write) {
+        std::cout << numRenders << " references written to " << directory.getFullPathName() << "\n";
+        return 0;
+    }
+    std::cout << numRenders << " renders: " << numIdentical << " identical, "
+              << (numRenders - numIdentical - numFailed) << " within the limits, " << numFailed << " failed\n";
+    return (numFailed > 0) ? 1 : 0;
+}
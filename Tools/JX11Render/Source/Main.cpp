@@ -0,0 +1,324 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 17 Oct 2026 12:20:44pm
+    Author:  garam
+
+    Offline renderer: plays a Standard MIDI File through the JX11 synth
+    and writes the result to a WAV file as fast as the CPU allows.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <chrono>
+#include <iostream>
+#include "../../../Source/Synth.h"
+#include "../../../Source/SynthParameters.h"
+#include "../../../Source/LoadMeter.h"
+#include "../../../Source/PluginState.h"
+#include "../../../Source/EventCoalescer.h"
+
+static void printUsage()
+{
+    std::cout << "Usage: JX11Render [options] input.mid output.wav\n"
+                 "  --preset N     factory preset index (default 0)\n"
+                 "  --state FILE   plugin state saved by the Standalone app, or its XML\n"
+                 "  --rate HZ      sample rate (default 48000)\n"
+                 "  --block N      samples per block (default 512)\n"
+                 "  --threads N    threads that render the voices (default 1)\n"
+                 "  --oversampling N  run the voices at 1, 2 or 4 times the rate (default 1)\n"
+                 "  --quality N    oversampling filters: 0 = Normal, 1 = High (default 0)\n"
+                 "  --control N    control rate, index of the Control Rate choice (default 0)\n"
+                 "  --interpolate  glide the filter between control steps\n"
+                 "  --grid N       snap controller messages to N samples, like MIDI CC Grid (default 1 = off)\n"
+                 "  --bits N       WAV bit depth: 16, 24 or 32 (default 24)\n"
+                 "  --tail SEC     render time after the last MIDI event (default 2)\n"
+                 "  --list         print the factory presets and exit\n";
+}
+
+// Reads the parameter values from a state written by getStateInformation()
+static bool loadState(const juce::File& file, float* param)
+{
+    juce::MemoryBlock data;
+    if (!file.loadFileAsData(data)) { return false; }
+
+    // Only the preset parameters are used, the options set the others
+    float values[NUM_STATE_PARAMS] = {};
+    std::copy(param, param + NUM_PARAMS, values);
+    if (readBinaryState(data.getData(), data.getSize(), values) >= 0) {
+        std::copy(values, values + NUM_PARAMS, param);
+        return true;
+    }
+
+    // Older versions saved XML. copyXmlToBinary() writes a magic number and the size in front of the XML
+    const juce::uint32 magicXmlNumber = 0x21324356;
+    juce::String xmlText;
+    if (data.getSize() > 8 && juce::ByteOrder::littleEndianInt(data.getData()) == magicXmlNumber) {
+        auto stringLength = (int)juce::ByteOrder::littleEndianInt(data.begin() + 4);
+        stringLength = juce::jmin(stringLength, (int)data.getSize() - 8);
+        xmlText = juce::String::fromUTF8(data.begin() + 8, stringLength);
+    }
+    else {
+        xmlText = data.toString();
+    }
+
+    auto xml = juce::parseXML(xmlText);
+    if (xml == nullptr) { return false; }
+
+    for (auto* child : xml->getChildWithTagNameIterator("PARAM")) {
+        juce::String id = child->getStringAttribute("id");
+        for (int i = 0; i < NUM_PARAMS; ++i) {
+            if (id == STATE_PARAMETER_IDS[i]) {
+                param[i] = float(child->getDoubleAttribute("value", param[i]));
+            }
+        }
+    }
+    return true;
+}
+
+// Same as JX11AudioProcessor::reset()
+static void resetSynth(Synth& synth, const float* param)
+{
+    synth.reset();
+    synth.outputLevelSmoother.setCurrentAndTargetValue(
+        juce::Decibels::decibelsToGain(param[PARAM_OUTPUT_LEVEL]));
+}
+
+int main(int argc, char* argv[])
+{
+    int presetIndex = 0;
+    juce::File stateFile;
+    double sampleRate = 48000.0;
+    int blockSize = 512;
+    int renderThreads = 1;
+    int oversampling = 1;
+    int oversamplingQuality = 0;
+    int controlRate = 0;
+    bool interpolateFilter = false;
+    int midiGrid = 1;
+    int bitDepth = 24;
+    double tailSeconds = 2.0;
+    juce::StringArray files;
+
+    for (int i = 1; i < argc; ++i) {
+        juce::String arg(argv[i]);
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--list") {
+            for (int p = 0; p < NUM_FACTORY_PRESETS; ++p) {
+                std::cout << p << ": " << FACTORY_PRESETS[p].name << "\n";
+            }
+            return 0;
+        }
+        else if (arg == "--preset" && hasValue) { presetIndex = juce::String(argv[++i]).getIntValue(); }
+        else if (arg == "--state" && hasValue) { stateFile = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]); }
+        else if (arg == "--rate" && hasValue) { sampleRate = juce::String(argv[++i]).getDoubleValue(); }
+        else if (arg == "--block" && hasValue) { blockSize = juce::String(argv[++i]).getIntValue(); }
+        else if (arg == "--threads" && hasValue) { renderThreads = juce::String(argv[++i]).getIntValue(); }
+        else if (arg == "--oversampling" && hasValue) { oversampling = juce::String(argv[++i]).getIntValue(); }
+        else if (arg == "--quality" && hasValue) { oversamplingQuality = juce::String(argv[++i]).getIntValue(); }
+        else if (arg == "--control" && hasValue) { controlRate = juce::String(argv[++i]).getIntValue(); }
+        else if (arg == "--interpolate") { interpolateFilter = true; }
+        else if (arg == "--grid" && hasValue) { midiGrid = juce::String(argv[++i]).getIntValue(); }
+        else if (arg == "--bits" && hasValue) { bitDepth = juce::String(argv[++i]).getIntValue(); }
+        else if (arg == "--tail" && hasValue) { tailSeconds = juce::String(argv[++i]).getDoubleValue(); }
+        else if (arg.startsWith("--")) { printUsage(); return 1; }
+        else { files.add(arg); }
+    }
+
+    if (files.size() != 2 || sampleRate <= 0.0 || blockSize <= 0 || midiGrid < 1
+        || (oversampling != 1 && oversampling != 2 && oversampling != 4)
+        || oversamplingQuality < 0 || oversamplingQuality >= Oversampler::NUM_QUALITIES
+        || controlRate < 0 || controlRate >= NUM_CONTROL_RATES
+        || presetIndex < 0 || presetIndex >= NUM_FACTORY_PRESETS) {
+        printUsage();
+        return 1;
+    }
+
+    // Parameters come from a factory preset, optionally overridden by a saved state
+    float param[NUM_PARAMS];
+    std::memcpy(param, FACTORY_PRESETS[presetIndex].param, sizeof(param));
+    if (stateFile != juce::File() && !loadState(stateFile, param)) {
+        std::cerr << "Could not read state from " << stateFile.getFullPathName() << "\n";
+        return 1;
+    }
+
+    // Read the MIDI file and merge all tracks into one sequence
+    auto inputFile = juce::File::getCurrentWorkingDirectory().getChildFile(files[0]);
+    juce::FileInputStream inputStream(inputFile);
+    juce::MidiFile midiFile;
+    if (!inputStream.openedOk() || !midiFile.readFrom(inputStream)) {
+        std::cerr << "Could not read MIDI file " << inputFile.getFullPathName() << "\n";
+        return 1;
+    }
+    midiFile.convertTimestampTicksToSeconds();
+
+    juce::MidiMessageSequence sequence;
+    for (int t = 0; t < midiFile.getNumTracks(); ++t) {
+        sequence.addSequence(*midiFile.getTrack(t), 0.0);
+    }
+
+    // Open the WAV writer
+    auto outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(files[1]);
+    outputFile.deleteFile();
+    auto outputStream = std::make_unique<juce::FileOutputStream>(outputFile);
+    if (!outputStream->openedOk()) {
+        std::cerr << "Could not create " << outputFile.getFullPathName() << "\n";
+        return 1;
+    }
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wavFormat.createWriterFor(
+        outputStream.get(), sampleRate, 2, bitDepth, {}, 0));
+    if (writer == nullptr) {
+        std::cerr << "Unsupported WAV format\n";
+        return 1;
+    }
+    outputStream.release(); // the writer owns the stream now
+
+    juce::ScopedNoDenormals noDenormals;
+
+    Synth synth;
+    synth.allocateResources(sampleRate, blockSize);
+    synth.startRenderThreads(renderThreads);
+
+    // Everything is worked out for the rate the voices run at
+    const float voiceRate = float(sampleRate) * float(oversampling);
+
+    SynthSettings settings;
+    settings.renderThreads = renderThreads;
+    settings.oversampling = oversampling;
+    settings.oversamplingQuality = oversamplingQuality;
+    settings.controlInterval = controlIntervalFor(controlRate, voiceRate);
+    settings.interpolateFilter = interpolateFilter;
+    applyParameters(settings, param, voiceRate);
+    synth.setSettings(&settings);
+    resetSynth(synth, param);
+
+    // Same handling as JX11AudioProcessor::handleMIDI
+    auto handleMIDI = [&](uint8_t data0, uint8_t data1, uint8_t data2)
+    {
+        if ((data0 & 0xF0) == 0xC0 && data1 < NUM_FACTORY_PRESETS) {
+            std::memcpy(param, FACTORY_PRESETS[data1].param, sizeof(param));
+            applyParameters(settings, param, voiceRate);
+            synth.setSettings(&settings);
+            resetSynth(synth, param);
+        }
+        if ((data0 & 0xF0) == 0xB0 && data1 == 0x07) {
+            // Snap to the 0.1 dB steps of the Output Level parameter
+            float level = 30.0f * float(data2) / 127.0f;
+            param[PARAM_OUTPUT_LEVEL] = -24.0f + 0.1f * std::floor(level * 10.0f + 0.5f);
+            applyParameters(settings, param, voiceRate, parameterBit(PARAM_OUTPUT_LEVEL));
+            synth.setSettings(&settings);
+        }
+        synth.midiMessage(data0, data1, data2);
+    };
+
+    juce::int64 lastEvent = 0;
+    if (sequence.getNumEvents() > 0) {
+        lastEvent = juce::int64(std::llround(sequence.getEndTime() * sampleRate));
+    }
+    const juce::int64 totalSamples = lastEvent + juce::int64(tailSeconds * sampleRate);
+
+    juce::AudioBuffer<float> buffer(2, blockSize);
+    int nextEvent = 0;
+
+    // The events of a block, thinned out like the plugin does
+    std::vector<MidiEvent> blockEvents;
+    blockEvents.reserve(size_t(sequence.getNumEvents()));
+    EventCoalescer coalescer;
+
+    // Times every block like the plugin does, the summary covers all of them
+    const juce::int64 numBlocks = (totalSamples + blockSize - 1) / blockSize;
+    LoadMeter loadMeter(int(juce::jlimit(juce::int64(1), juce::int64(1 << 24), numBlocks)));
+    loadMeter.prepare(sampleRate);
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    for (juce::int64 blockStart = 0; blockStart < totalSamples; blockStart += blockSize) {
+        int numSamples = int(juce::jmin(juce::int64(blockSize), totalSamples - blockStart));
+        {
+            LoadMeter::Scope blockTimer(loadMeter, numSamples);
+            int bufferOffset = 0;
+
+            auto render = [&](int sampleCount)
+            {
+                float* outputBuffers[2] = {
+                    buffer.getWritePointer(0) + bufferOffset,
+                    buffer.getWritePointer(1) + bufferOffset,
+                };
+                synth.render(outputBuffers, sampleCount);
+                bufferOffset += sampleCount;
+            };
+
+            // Take the MIDI events in this block, ignoring sysex and meta events
+            blockEvents.clear();
+            while (nextEvent < sequence.getNumEvents()) {
+                const auto& message = sequence.getEventPointer(nextEvent)->message;
+                juce::int64 position = juce::int64(std::llround(message.getTimeStamp() * sampleRate));
+                if (position >= blockStart + numSamples) { break; }
+
+                if (!message.isMetaEvent() && message.getRawDataSize() <= 3) {
+                    const juce::uint8* data = message.getRawData();
+                    int numBytes = message.getRawDataSize();
+                    uint8_t data1 = (numBytes >= 2) ? data[1] : 0;
+                    uint8_t data2 = (numBytes == 3) ? data[2] : 0;
+                    int offset = int(juce::jmax(juce::int64(0), position - blockStart));
+                    blockEvents.push_back({ offset, data[0], data1, data2 });
+                }
+                ++nextEvent;
+            }
+            int numEvents = coalescer.process(blockEvents.data(), int(blockEvents.size()), midiGrid);
+
+            // Render up to each MIDI event in this block, then handle it
+            for (int i = 0; i < numEvents; ++i) {
+                const MidiEvent& event = blockEvents[size_t(i)];
+                int samplesThisSegment = event.position - bufferOffset;
+                if (samplesThisSegment > 0) {
+                    render(samplesThisSegment);
+                }
+                handleMIDI(event.data0, event.data1, event.data2);
+            }
+
+            if (numSamples - bufferOffset > 0) {
+                render(numSamples - bufferOffset);
+            }
+        }
+
+        // The ring only holds so many blocks
+        if ((blockStart / blockSize) % (LoadMeter::RING_SIZE / 2) == 0) {
+            loadMeter.update();
+        }
+
+        writer->writeFromAudioSampleBuffer(buffer, 0, numSamples);
+    }
+
+    writer.reset(); // flush the file before stopping the clock
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    double seconds = double(totalSamples) / sampleRate;
+
+    std::cout << "Rendered " << seconds << " s of audio with preset \""
+              << (stateFile != juce::File() ? stateFile.getFileName() : juce::String(FACTORY_PRESETS[presetIndex].name))
+              << "\" in " << elapsed << " s (" << (elapsed > 0.0 ? seconds / elapsed : 0.0)
+              << "x realtime)\n";
+
+    // Time per block, as the plugin's meter shows it. At small block sizes
+    // this tells which patches can't keep up.
+    LoadMeter::Summary load = loadMeter.update();
+    std::cout << "Block time p50 " << load.p50 << " us, p99 " << load.p99 << " us, max " << load.max
+              << " us, load " << load.load * 100.0 << " %, " << load.overruns << " of " << load.blocks
+              << " blocks over budget\nLoad histogram:";
+    for (int bucket = 0; bucket < LoadMeter::NUM_BUCKETS; ++bucket) {
+        std::cout << " " << juce::roundToInt(LoadMeter::bucketStart(bucket) * 100.0) << "%:" << load.histogram[bucket];
+    }
+    std::cout << "\n";
+
+    // The plugin only counts these, an offline render can say so
+    const OutputSafetyCounters& counters = synth.getSafetyCounters();
+    if (counters.silenced.load() > 0 || counters.clamped.load() > 0) {
+        std::cout << "Output safety: " << counters.silenced.load() << " buffers muted, "
+                  << counters.clamped.load() << " clipped\n";
+    }
+    return 0;
+}